@@ -0,0 +1,115 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+
+#include "internal.hpp"
+#include "bench.hpp"
+
+// Output is a JSON array, one object per function, parameter combination and environment.
+
+typedef _CXTSTR (*user_dir_func)(const _CXTSTR*, const _CXTSTR*, const _CXTSTR*, const bool, int*);
+typedef std::vector<_CXTSTR> (*site_dir_func)(const _CXTSTR*, const _CXTSTR*, const _CXTSTR*, const bool, int*);
+
+struct bench_case {
+	const char* name;
+	user_dir_func user_dir;
+	site_dir_func site_dir;
+};
+
+static const std::array<bench_case, 7> bench_cases = { {
+	{ "user_data_dir", user_data_dir, nullptr },
+	{ "site_data_dir", nullptr, site_data_dir },
+	{ "user_config_dir", user_config_dir, nullptr },
+	{ "site_config_dir", nullptr, site_config_dir },
+	{ "user_cache_dir", user_cache_dir, nullptr },
+	{ "user_state_dir", user_state_dir, nullptr },
+	{ "user_log_dir", user_log_dir, nullptr },
+} };
+
+#if !defined(_WIN32)
+static const char* const xdg_variables[][2] = {
+	{ "XDG_DATA_HOME", "/tmp/AppDirsCPP/data" },
+	{ "XDG_CONFIG_HOME", "/tmp/AppDirsCPP/config" },
+	{ "XDG_CACHE_HOME", "/tmp/AppDirsCPP/cache" },
+	{ "XDG_STATE_HOME", "/tmp/AppDirsCPP/state" },
+	{ "XDG_DATA_DIRS", "/tmp/AppDirsCPP/site/data:/usr/local/share:/usr/share" },
+	{ "XDG_CONFIG_DIRS", "/tmp/AppDirsCPP/site/config:/etc/xdg" },
+};
+
+static void set_xdg_variables(const bool set)
+{
+	for (const auto& variable : xdg_variables) {
+		if (set) {
+			setenv(variable[0], variable[1], 1);
+		}
+		else {
+			unsetenv(variable[0]);
+		}
+	}
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	const std::uint64_t batch_size = 1000;
+	const unsigned batch_count = 100;
+	bool first = true;
+
+	cout << "[\n";
+	for (int xdg = 0; xdg < 2; xdg++) {
+#if defined(_WIN32)
+		if (xdg) {
+			break; // XDG variables are not used on Windows.
+		}
+#else
+		set_xdg_variables(xdg != 0);
+#endif
+		for (const bench_case& test : bench_cases) {
+			unsigned i = 0;
+			std::bitset<4> param_test = i;
+			const auto param_combo_total = static_cast<unsigned>(std::pow(2, param_test.size()));
+			while (i < param_combo_total) {
+				const _CXTSTR* appname = param_test[0] ? &AppDirsCPP_cstr : NULL;
+				const _CXTSTR* appauthor = param_test[1] ? &AppAuthor_cstr : NULL;
+				const _CXTSTR* version = param_test[2] ? &version_cstr : NULL;
+				bool option = param_test[3] ? true : false;
+
+				const auto resolve = [&]() {
+					if (test.user_dir) {
+						bench_keep(test.user_dir(appname, appauthor, version, option, nullptr));
+					}
+					else {
+						bench_keep(test.site_dir(appname, appauthor, version, option, nullptr));
+					}
+				};
+				const bench_result result = bench_measure(resolve, batch_size, batch_count);
+
+				if (!first) {
+					cout << ",\n";
+				}
+				first = false;
+				cout << std::fixed << std::setprecision(1);
+				cout << "  {\"function\": \"" << test.name << "\", \"params\": \"" << reverse_bits(param_test) << "\"";
+				cout << ", \"xdg\": " << (xdg ? "true" : "false");
+				cout << ", \"mean_ns\": " << result.mean_ns << ", \"median_ns\": " << result.median_ns;
+				cout << ", \"p99_ns\": " << result.p99_ns;
+				cout << std::setprecision(0) << ", \"calls_per_second\": " << result.calls_per_second << "}";
+
+				param_test = ++i;
+			}
+		}
+	}
+	cout << "\n]\n";
+
+#if !defined(_WIN32)
+	set_xdg_variables(false);
+#endif
+	return 0;
+}
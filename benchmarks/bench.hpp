@@ -0,0 +1,70 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <chrono>
+#include <cstdint>
+
+// Prevent the compiler from optimizing away a benchmarked result.
+// Nothing is shared between threads, so bench_threads only measures the resolvers.
+#if defined(__GNUC__) || defined(__clang__)
+template<typename T>
+static inline void bench_keep(const T& value)
+{
+	asm volatile("" : : "r"(&value) : "memory");
+}
+#else
+static thread_local const void* volatile bench_sink;
+
+template<typename T>
+static inline void bench_keep(const T& value)
+{
+	bench_sink = &value;
+}
+#endif
+
+// Return average nanoseconds spent per call of func over iterations calls.
+template<typename F>
+static inline double bench_ns_per_call(F func, const std::uint64_t iterations)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (std::uint64_t i = 0; i < iterations; i++) {
+		func();
+	}
+	const auto end = std::chrono::steady_clock::now();
+	const std::chrono::duration<double, std::nano> elapsed = end - start;
+	return elapsed.count() / static_cast<double>(iterations);
+}
+
+#include <algorithm>
+#include <vector>
+
+// Latency of func, measured as the average of each batch of calls.
+struct bench_result {
+	double mean_ns;
+	double median_ns;
+	double p99_ns;
+	double calls_per_second;
+};
+
+template<typename F>
+static inline bench_result bench_measure(F func, const std::uint64_t batch_size, const unsigned batch_count)
+{
+	std::vector<double> batches;
+	batches.reserve(batch_count);
+	double total = 0;
+	for (unsigned i = 0; i < batch_count; i++) {
+		const double batch = bench_ns_per_call(func, batch_size);
+		batches.push_back(batch);
+		total += batch;
+	}
+	std::sort(batches.begin(), batches.end());
+
+	bench_result result;
+	result.mean_ns = total / batch_count;
+	result.median_ns = batches[batch_count / 2];
+	result.p99_ns = batches[std::min<size_t>(batch_count - 1, batch_count * 99 / 100)];
+	result.calls_per_second = 1e9 / result.mean_ns;
+	return result;
+}
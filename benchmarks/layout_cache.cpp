@@ -0,0 +1,42 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+#include <iomanip>
+
+#include "internal.hpp"
+#include "bench.hpp"
+
+int main(int argc, char const* argv[])
+{
+	const std::uint64_t iterations = 200000;
+
+	// uncached: every call reads the environment and home directory.
+	const auto resolve = []() {
+		bench_keep(user_cache_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr));
+	};
+	const auto refresh_resolve = [&resolve]() {
+		appdirs_refresh();
+		resolve();
+	};
+
+	appdirs_set_cached(false);
+	const double uncached = bench_ns_per_call(resolve, iterations);
+
+	// cold: the snapshot is rebuilt before every call.
+	appdirs_set_cached(true);
+	const double cold = bench_ns_per_call(refresh_resolve, iterations);
+
+	// warm: the snapshot is reused.
+	const double warm = bench_ns_per_call(resolve, iterations);
+	appdirs_set_cached(false);
+
+	cout << std::fixed << std::setprecision(1);
+	cout << "user_cache_dir uncached: " << uncached << " ns/call\n";
+	cout << "user_cache_dir cold:     " << cold << " ns/call\n";
+	cout << "user_cache_dir warm:     " << warm << " ns/call\n";
+	return 0;
+}
@@ -0,0 +1,71 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+#include <iomanip>
+
+#include "internal.hpp"
+#include "bench.hpp"
+
+int main(int argc, char const* argv[])
+{
+#if defined(_WIN32) || defined(__APPLE__)
+	cout << "XDG_DATA_DIRS is not used on this platform.\n";
+#else
+	const unsigned entry_counts[] = { 1, 10, 100, 1000 };
+	std::vector<_CXTCHAR> buffer(1 << 20);
+
+	cout << std::fixed << std::setprecision(1);
+	for (const unsigned entry_count : entry_counts) {
+		// Similar to a Nix profile, every entry is a long store path.
+		_CXTSTR data_dirs;
+		for (unsigned i = 0; i < entry_count; i++) {
+			if (i) {
+				data_dirs += pathsep;
+			}
+			data_dirs += "/nix/store/0123456789abcdfghijklmnpqrsvwxyz-package-" + std::to_string(i) + "/share";
+		}
+		setenv("XDG_DATA_DIRS", data_dirs.c_str(), 1);
+
+		const std::uint64_t iterations = 2000000 / entry_count;
+		const auto resolve_vector = []() {
+			bench_keep(site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true));
+		};
+		const auto resolve_buffer = [&buffer]() {
+			bench_keep(site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true, buffer.data(), buffer.size()));
+		};
+		const double vector_ns = bench_ns_per_call(resolve_vector, iterations);
+		const double buffer_ns = bench_ns_per_call(resolve_buffer, iterations);
+
+		cout << "site_data_dir multipath, " << std::setw(4) << entry_count << " entries: ";
+		cout << "vector " << vector_ns << " ns/call (" << vector_ns / entry_count << " ns/entry), ";
+		cout << "buffer " << buffer_ns << " ns/call (" << buffer_ns / entry_count << " ns/entry)\n";
+	}
+
+	// Every entry twice, so the list is normalized on every call.
+	for (const unsigned entry_count : entry_counts) {
+		_CXTSTR data_dirs;
+		for (unsigned i = 0; i < entry_count * 2; i++) {
+			if (i) {
+				data_dirs += pathsep;
+			}
+			data_dirs += "/nix/store/0123456789abcdfghijklmnpqrsvwxyz-package-" + std::to_string(i % entry_count) + "/share";
+		}
+		setenv("XDG_DATA_DIRS", data_dirs.c_str(), 1);
+
+		const std::uint64_t iterations = 1000000 / entry_count;
+		const auto resolve_buffer = [&buffer]() {
+			bench_keep(site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true, buffer.data(), buffer.size()));
+		};
+		const double buffer_ns = bench_ns_per_call(resolve_buffer, iterations);
+
+		cout << "site_data_dir multipath, " << std::setw(4) << entry_count << " entries, each twice: ";
+		cout << "buffer " << buffer_ns << " ns/call (" << buffer_ns / entry_count << " ns/entry)\n";
+	}
+	unsetenv("XDG_DATA_DIRS");
+#endif
+	return 0;
+}
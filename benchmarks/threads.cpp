@@ -0,0 +1,99 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+#include "internal.hpp"
+#include "bench.hpp"
+
+// Output is a JSON array, one object per mode and thread count.
+// Usage: bench_threads [max threads]
+
+// Return calls per second of each thread, while thread_count threads resolve user_cache_dir.
+static double calls_per_second_per_thread(const unsigned thread_count, const bool use_buffer)
+{
+	const std::uint64_t calls_per_thread = 200000;
+	std::atomic<unsigned> ready(0);
+	std::atomic<bool> start(false);
+	std::vector<std::thread> threads;
+	std::vector<double> ns_per_call(thread_count);
+
+	for (unsigned t = 0; t < thread_count; t++) {
+		threads.emplace_back([&, t]() {
+			_CXTCHAR buffer[512];
+			const auto resolve_string = []() {
+				bench_keep(user_cache_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr));
+			};
+			const auto resolve_buffer = [&buffer]() {
+				bench_keep(user_cache_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr, true, buffer, sizeof(buffer) / sizeof(buffer[0])));
+			};
+			ready++;
+			while (!start.load()) {
+				std::this_thread::yield();
+			}
+			ns_per_call[t] = use_buffer ? bench_ns_per_call(resolve_buffer, calls_per_thread)
+			                            : bench_ns_per_call(resolve_string, calls_per_thread);
+		});
+	}
+	while (ready.load() != thread_count) {
+		std::this_thread::yield();
+	}
+	start.store(true);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	double total = 0;
+	for (const double ns : ns_per_call) {
+		total += 1e9 / ns;
+	}
+	return total / thread_count;
+}
+
+int main(int argc, char const* argv[])
+{
+	unsigned max_threads = std::thread::hardware_concurrency();
+	if (argc > 1) {
+		max_threads = static_cast<unsigned>(std::atoi(argv[1]));
+	}
+	if (max_threads == 0) {
+		max_threads = 1;
+	}
+
+	// Powers of two, then max_threads itself.
+	std::vector<unsigned> thread_counts;
+	for (unsigned thread_count = 1; thread_count < max_threads; thread_count *= 2) {
+		thread_counts.push_back(thread_count);
+	}
+	thread_counts.push_back(max_threads);
+
+	bool first = true;
+	cout << "[\n";
+	for (int cached = 0; cached < 2; cached++) {
+		appdirs_set_cached(cached != 0);
+		for (int use_buffer = 0; use_buffer < 2; use_buffer++) {
+			for (const unsigned thread_count : thread_counts) {
+				const double per_thread = calls_per_second_per_thread(thread_count, use_buffer != 0);
+				if (!first) {
+					cout << ",\n";
+				}
+				first = false;
+				cout << std::fixed << std::setprecision(0);
+				cout << "  {\"function\": \"user_cache_dir\", \"cached\": " << (cached ? "true" : "false");
+				cout << ", \"output\": \"" << (use_buffer ? "buffer" : "string") << "\"";
+				cout << ", \"threads\": " << thread_count << ", \"calls_per_second_per_thread\": " << per_thread;
+				cout << ", \"calls_per_second\": " << per_thread * thread_count << "}";
+			}
+		}
+	}
+	cout << "\n]\n";
+	appdirs_set_cached(false);
+	return 0;
+}
@@ -4,15 +4,195 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <cstddef>
+#include <stdint.h>
+#if !defined(_WIN32)
+#include <sys/types.h>
+#endif
 #include <string>
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
 
 #ifdef _WIN32
 #define _CXTSTR std::wstring
+#define _CXTCHAR wchar_t
 #else
 #define _CXTSTR std::string
+#define _CXTCHAR char
+#endif
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#define APPDIRS_HAS_STRING_VIEW 1
+#endif
+
+/// <summary>
+/// Non-owning appname, appauthor, or version argument, for callers without a string object.
+/// <![CDATA[
+/// Converts from a null-terminated string, a string pointer, a string, and
+/// std::string_view in C++17, so string literals are passed without building
+/// a temporary string. A NULL string means the argument is not given. The
+/// characters must outlive the call.
+/// ]]>
+/// </summary>
+struct AppDirsStr {
+	const _CXTCHAR* data = nullptr;
+	size_t length = 0;
+
+	AppDirsStr() = default;
+	AppDirsStr(std::nullptr_t) {}
+	AppDirsStr(const _CXTCHAR* str)
+	    : data(str), length(str ? std::char_traits<_CXTCHAR>::length(str) : 0) {}
+	AppDirsStr(const _CXTCHAR* str, const size_t str_length)
+	    : data(str), length(str_length) {}
+	AppDirsStr(const _CXTSTR* str)
+	    : data(str ? str->c_str() : nullptr), length(str ? str->length() : 0) {}
+	AppDirsStr(const _CXTSTR& str)
+	    : data(str.c_str()), length(str.length()) {}
+#if defined(APPDIRS_HAS_STRING_VIEW)
+	AppDirsStr(const std::basic_string_view<_CXTCHAR> str)
+	    : data(str.data()), length(str.length()) {}
+#endif
+
+	explicit operator bool() const
+	{
+		return data != nullptr;
+	}
+};
+
+namespace appdirs_detail {
+struct path_list_access;
+} // namespace appdirs_detail
+
+/// <summary>
+/// Full paths of a multi-path resolver, returned by site_data_dir and site_config_dir.
+/// <![CDATA[
+/// Every entry is stored null-terminated in a single buffer, with a table of
+/// offsets. Filling a PathList costs at most two allocations however many
+/// entries there are, and none when it is reused with enough capacity.
+/// ]]>
+/// </summary>
+class PathList {
+public:
+#if defined(APPDIRS_HAS_STRING_VIEW)
+	typedef std::basic_string_view<_CXTCHAR> view;
+#else
+	typedef AppDirsStr view;
 #endif
 
+	class iterator {
+	public:
+		iterator(const PathList& list, const size_t index)
+		    : list_(&list), index_(index) {}
+
+		view operator*() const
+		{
+			return view(list_->get(index_), list_->length(index_));
+		}
+		iterator& operator++()
+		{
+			index_++;
+			return *this;
+		}
+		bool operator==(const iterator& other) const
+		{
+			return index_ == other.index_;
+		}
+		bool operator!=(const iterator& other) const
+		{
+			return index_ != other.index_;
+		}
+
+	private:
+		const PathList* list_;
+		size_t index_;
+	};
+
+	/// <summary>
+	/// Return the number of entries.
+	/// </summary>
+	size_t size() const
+	{
+		return offsets_.empty() ? 0 : offsets_.size() - 1;
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	/// <summary>
+	/// Return the null-terminated full path of entry index.
+	/// </summary>
+	const _CXTCHAR* get(const size_t index) const
+	{
+		return buffer_.c_str() + offsets_[index];
+	}
+
+	/// <summary>
+	/// Return the length of entry index, excluding null terminator.
+	/// </summary>
+	size_t length(const size_t index) const
+	{
+		return offsets_[index + 1] - offsets_[index] - 1;
+	}
+
+	/// <summary>
+	/// Return entry index as a new string.
+	/// </summary>
+	_CXTSTR str(const size_t index) const
+	{
+		return buffer_.substr(offsets_[index], length(index));
+	}
+
+	view operator[](const size_t index) const
+	{
+		return view(get(index), length(index));
+	}
+
+	iterator begin() const
+	{
+		return iterator(*this, 0);
+	}
+
+	iterator end() const
+	{
+		return iterator(*this, size());
+	}
+
+	/// <summary>
+	/// Remove every entry, keeping the memory for the next call.
+	/// </summary>
+	void clear()
+	{
+		buffer_.clear();
+		offsets_.clear();
+	}
+
+	/// <summary>
+	/// Return every entry as a new string, as returned by the vector overloads.
+	/// </summary>
+	std::vector<_CXTSTR> to_vector() const
+	{
+		std::vector<_CXTSTR> paths;
+		paths.reserve(size());
+		for (size_t i = 0; i < size(); i++) {
+			paths.push_back(str(i));
+		}
+		return paths;
+	}
+
+private:
+	friend struct appdirs_detail::path_list_access;
+
+	_CXTSTR buffer_;
+	// Start of each entry, followed by the end of the buffer.
+	std::vector<size_t> offsets_;
+};
+
 /// <summary>
 /// See header file for human readable chart.
 /// <![CDATA[
@@ -57,6 +237,40 @@ _CXTSTR user_data_dir(
     const bool roaming = false,
     int* error = nullptr);
 
+/// <summary>
+/// Same as user_data_dir, except the full path is appended to an existing string.
+/// <para/>No memory is allocated when full_path has enough capacity.
+/// </summary>
+/// <param name="full_path"> receives the full path.
+/// </param>
+/// <returns>Return the number of characters appended, or 0 on failure.</returns>
+size_t user_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_data_dir, except the full path is written to a caller-provided buffer.
+/// <para/>No memory is allocated.
+/// </summary>
+/// <param name="buffer"> receives the null-terminated full path. Truncated if too small, like snprintf.
+/// </param>
+/// <param name="buffer_size"> is the number of characters available in buffer.
+/// </param>
+/// <returns>Return the length of the full path, excluding null terminator. If it is not less than buffer_size, the buffer was too small.</returns>
+size_t user_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
 
 /// <summary>
 /// See header file for human readable chart.
@@ -102,6 +316,56 @@ std::vector<_CXTSTR> site_data_dir(
     const bool multipath = false,
     int* error = nullptr);
 
+/// <summary>
+/// Same as site_data_dir, except the full paths are joined by path separator and appended to an existing string.
+/// <para/>No memory is allocated when full_paths has enough capacity.
+/// </summary>
+/// <param name="full_paths"> receives the full paths, joined by path separator.
+/// </param>
+/// <returns>Return the number of characters appended, or 0 on failure.</returns>
+size_t site_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    _CXTSTR& full_paths,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as site_data_dir, except the full paths are joined by path separator and written to a caller-provided buffer.
+/// <para/>No memory is allocated.
+/// </summary>
+/// <param name="buffer"> receives the null-terminated full paths, joined by path separator. Truncated if too small, like snprintf.
+/// </param>
+/// <param name="buffer_size"> is the number of characters available in buffer.
+/// </param>
+/// <returns>Return the length of the joined full paths, excluding null terminator. If it is not less than buffer_size, the buffer was too small.</returns>
+size_t site_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as site_data_dir, except each full path is written to a PathList.
+/// <para/>At most two allocations, none when paths has enough capacity.
+/// </summary>
+/// <param name="paths"> receives the full paths, replacing any previous entries.
+/// </param>
+/// <returns>Return the number of entries, or 0 on failure.</returns>
+size_t site_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    PathList& paths,
+    int* error = nullptr);
+
 
 /// <summary>
 /// See header file for human readable chart.
@@ -144,6 +408,40 @@ _CXTSTR user_config_dir(
     const bool roaming = false,
     int* error = nullptr);
 
+/// <summary>
+/// Same as user_config_dir, except the full path is appended to an existing string.
+/// <para/>No memory is allocated when full_path has enough capacity.
+/// </summary>
+/// <param name="full_path"> receives the full path.
+/// </param>
+/// <returns>Return the number of characters appended, or 0 on failure.</returns>
+size_t user_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_config_dir, except the full path is written to a caller-provided buffer.
+/// <para/>No memory is allocated.
+/// </summary>
+/// <param name="buffer"> receives the null-terminated full path. Truncated if too small, like snprintf.
+/// </param>
+/// <param name="buffer_size"> is the number of characters available in buffer.
+/// </param>
+/// <returns>Return the length of the full path, excluding null terminator. If it is not less than buffer_size, the buffer was too small.</returns>
+size_t user_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
 
 /// <summary>
 /// See header file for human readable chart.
@@ -189,6 +487,56 @@ std::vector<_CXTSTR> site_config_dir(
     const bool multipath = false,
     int* error = nullptr);
 
+/// <summary>
+/// Same as site_config_dir, except the full paths are joined by path separator and appended to an existing string.
+/// <para/>No memory is allocated when full_paths has enough capacity.
+/// </summary>
+/// <param name="full_paths"> receives the full paths, joined by path separator.
+/// </param>
+/// <returns>Return the number of characters appended, or 0 on failure.</returns>
+size_t site_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    _CXTSTR& full_paths,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as site_config_dir, except the full paths are joined by path separator and written to a caller-provided buffer.
+/// <para/>No memory is allocated.
+/// </summary>
+/// <param name="buffer"> receives the null-terminated full paths, joined by path separator. Truncated if too small, like snprintf.
+/// </param>
+/// <param name="buffer_size"> is the number of characters available in buffer.
+/// </param>
+/// <returns>Return the length of the joined full paths, excluding null terminator. If it is not less than buffer_size, the buffer was too small.</returns>
+size_t site_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as site_config_dir, except each full path is written to a PathList.
+/// <para/>At most two allocations, none when paths has enough capacity.
+/// </summary>
+/// <param name="paths"> receives the full paths, replacing any previous entries.
+/// </param>
+/// <returns>Return the number of entries, or 0 on failure.</returns>
+size_t site_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    PathList& paths,
+    int* error = nullptr);
+
 
 /// <summary>
 /// See header file for human readable chart.
@@ -236,6 +584,40 @@ _CXTSTR user_cache_dir(
     const bool opinion = true,
     int* error = nullptr);
 
+/// <summary>
+/// Same as user_cache_dir, except the full path is appended to an existing string.
+/// <para/>No memory is allocated when full_path has enough capacity.
+/// </summary>
+/// <param name="full_path"> receives the full path.
+/// </param>
+/// <returns>Return the number of characters appended, or 0 on failure.</returns>
+size_t user_cache_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_cache_dir, except the full path is written to a caller-provided buffer.
+/// <para/>No memory is allocated.
+/// </summary>
+/// <param name="buffer"> receives the null-terminated full path. Truncated if too small, like snprintf.
+/// </param>
+/// <param name="buffer_size"> is the number of characters available in buffer.
+/// </param>
+/// <returns>Return the length of the full path, excluding null terminator. If it is not less than buffer_size, the buffer was too small.</returns>
+size_t user_cache_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
 
 /// <summary>
 /// See header file for human readable chart.
@@ -281,6 +663,40 @@ _CXTSTR user_state_dir(
     const bool roaming = false,
     int* error = nullptr);
 
+/// <summary>
+/// Same as user_state_dir, except the full path is appended to an existing string.
+/// <para/>No memory is allocated when full_path has enough capacity.
+/// </summary>
+/// <param name="full_path"> receives the full path.
+/// </param>
+/// <returns>Return the number of characters appended, or 0 on failure.</returns>
+size_t user_state_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_state_dir, except the full path is written to a caller-provided buffer.
+/// <para/>No memory is allocated.
+/// </summary>
+/// <param name="buffer"> receives the null-terminated full path. Truncated if too small, like snprintf.
+/// </param>
+/// <param name="buffer_size"> is the number of characters available in buffer.
+/// </param>
+/// <returns>Return the length of the full path, excluding null terminator. If it is not less than buffer_size, the buffer was too small.</returns>
+size_t user_state_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
 
 /// <summary>
 /// See header file for human readable chart.
@@ -326,3 +742,1863 @@ _CXTSTR user_log_dir(
     const _CXTSTR* version = nullptr,
     const bool opinion = true,
     int* error = nullptr);
+
+/// <summary>
+/// Same as user_log_dir, except the full path is appended to an existing string.
+/// <para/>No memory is allocated when full_path has enough capacity.
+/// </summary>
+/// <param name="full_path"> receives the full path.
+/// </param>
+/// <returns>Return the number of characters appended, or 0 on failure.</returns>
+size_t user_log_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_log_dir, except the full path is written to a caller-provided buffer.
+/// <para/>No memory is allocated.
+/// </summary>
+/// <param name="buffer"> receives the null-terminated full path. Truncated if too small, like snprintf.
+/// </param>
+/// <param name="buffer_size"> is the number of characters available in buffer.
+/// </param>
+/// <returns>Return the length of the full path, excluding null terminator. If it is not less than buffer_size, the buffer was too small.</returns>
+size_t user_log_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+/// <summary>
+/// See header file for human readable chart.
+/// <![CDATA[
+/// Typical user runtime directories are:
+///   Mac OS X:  ~/Library/Caches/TemporaryItems/<AppName>
+///   Unix:      $XDG_RUNTIME_DIR/<AppName>  # or /dev/shm/runtime-<uid>/<AppName>
+///   Win *:     C:\Users\<username>\AppData\Local\Temp\<AppAuthor>\<AppName>
+///
+/// For sockets, lock files, and other small files that do not outlive the
+/// user's session. On Unix, $XDG_RUNTIME_DIR is only used if it is an absolute
+/// path to a directory owned by the user with mode 0700, checked with a single
+/// fstatat. Otherwise, the per-uid directory under /dev/shm is returned, or
+/// under /tmp if /dev/shm is not usable. It is used only if missing, or if it
+/// passes the same checks without following a symlink, and it is only created
+/// by ensure_user_runtime_dir. With an explicit environment, whose owner is
+/// unknown, these checks are skipped.
+/// ]]>
+/// </summary>
+/// <param name="appname"> is the name of the application.<br/>
+/// <para/>&#160;&#160;&#160;&#160;If NULL, just the system directory is returned.
+/// </param>
+/// <param name="appauthor"> (only used on Windows) is the name of the
+/// <para/>&#160;&#160;&#160;&#160;appauthor or distributing body for this application.
+/// </param>
+/// <param name="version"> is an optional version path element to append to the path.
+/// </param>
+/// <param name="error">: If returned path is NULL, check value for any faults. Assumed using errno method.
+/// </param>
+/// <returns>Return full path to the user-specific runtime dir for this application.</returns>
+_CXTSTR user_runtime_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    int* error = nullptr);
+
+/// <summary>
+/// Same as user_runtime_dir, except the full path is appended to an existing string.
+/// <para/>No memory is allocated when full_path has enough capacity.
+/// </summary>
+/// <param name="full_path"> receives the full path.
+/// </param>
+/// <returns>Return the number of characters appended, or 0 on failure.</returns>
+size_t user_runtime_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_runtime_dir, except the full path is written to a caller-provided buffer.
+/// <para/>No memory is allocated.
+/// </summary>
+/// <param name="buffer"> receives the null-terminated full path. Truncated if too small, like snprintf.
+/// </param>
+/// <param name="buffer_size"> is the number of characters available in buffer.
+/// </param>
+/// <returns>Return the length of the full path, excluding null terminator. If it is not less than buffer_size, the buffer was too small.</returns>
+size_t user_runtime_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_data_dir, taking appname, appauthor, and version as AppDirsStr.
+/// <![CDATA[
+/// Selected when appname is a string literal, const char*, or
+/// std::string_view, so no temporary string is built. Passing string pointers
+/// or NULL still selects the original functions, which forward here. The same
+/// holds for the AppDirsStr overloads of every resolver below.
+/// ]]>
+/// </summary>
+_CXTSTR user_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor = nullptr,
+    const AppDirsStr& version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+size_t user_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+size_t user_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as site_data_dir, taking appname, appauthor, and version as AppDirsStr.
+/// </summary>
+std::vector<_CXTSTR> site_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor = nullptr,
+    const AppDirsStr& version = nullptr,
+    const bool multipath = false,
+    int* error = nullptr);
+size_t site_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+size_t site_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+size_t site_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    PathList& paths,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_config_dir, taking appname, appauthor, and version as AppDirsStr.
+/// </summary>
+_CXTSTR user_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor = nullptr,
+    const AppDirsStr& version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+size_t user_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+size_t user_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as site_config_dir, taking appname, appauthor, and version as AppDirsStr.
+/// </summary>
+std::vector<_CXTSTR> site_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor = nullptr,
+    const AppDirsStr& version = nullptr,
+    const bool multipath = false,
+    int* error = nullptr);
+size_t site_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+size_t site_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+size_t site_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    PathList& paths,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_cache_dir, taking appname, appauthor, and version as AppDirsStr.
+/// </summary>
+_CXTSTR user_cache_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor = nullptr,
+    const AppDirsStr& version = nullptr,
+    const bool opinion = true,
+    int* error = nullptr);
+size_t user_cache_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool opinion,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+size_t user_cache_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool opinion,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_state_dir, taking appname, appauthor, and version as AppDirsStr.
+/// </summary>
+_CXTSTR user_state_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor = nullptr,
+    const AppDirsStr& version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+size_t user_state_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+size_t user_state_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_log_dir, taking appname, appauthor, and version as AppDirsStr.
+/// </summary>
+_CXTSTR user_log_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor = nullptr,
+    const AppDirsStr& version = nullptr,
+    const bool opinion = true,
+    int* error = nullptr);
+size_t user_log_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool opinion,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+size_t user_log_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool opinion,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_runtime_dir, taking appname, appauthor, and version as AppDirsStr.
+/// </summary>
+_CXTSTR user_runtime_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor = nullptr,
+    const AppDirsStr& version = nullptr,
+    int* error = nullptr);
+size_t user_runtime_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+size_t user_runtime_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Enable or disable cached mode for every function.
+/// <![CDATA[
+/// When enabled, the first call takes a snapshot of the environment variables
+/// ($XDG_*, $HOME) and the user's home directory. Later calls only append the
+/// appname/appauthor/version suffix to the snapshot's base directories.
+/// Changes to the environment are not seen until appdirs_refresh is called.
+///
+/// In cached mode, functions neither call getenv nor take a lock, so they
+/// may be called from many threads, even while another thread calls setenv.
+/// ]]>
+/// </summary>
+/// <param name="enable"> is true to use the snapshot, false to resolve on every call (default).
+/// </param>
+void appdirs_set_cached(const bool enable);
+
+
+/// <summary>
+/// Rebuild the snapshot used by cached mode from the current environment.
+/// <para/>A replaced snapshot is freed once no thread is still resolving with it.
+/// </summary>
+void appdirs_refresh();
+
+
+/// <summary>
+/// Enable or disable canonical site directories on *nix.
+/// <![CDATA[
+/// site_data_dir and site_config_dir always drop empty, relative, and duplicate
+/// $XDG_DATA_DIRS and $XDG_CONFIG_DIRS entries, and trailing slashes. When
+/// enabled, each entry is also replaced by its realpath, and entries naming the
+/// same directory (st_dev, st_ino) are dropped. Real paths are looked up once,
+/// until appdirs_refresh is called, which also applies this to cached mode.
+/// ]]>
+/// </summary>
+/// <param name="enable"> is true to canonicalize entries, false to only normalize them (default).
+/// </param>
+void appdirs_set_canonical_site_dirs(const bool enable);
+
+
+#if !defined(_WIN32)
+/// <summary>
+/// Looks up the home directory of a user, used when $HOME is not set.
+/// </summary>
+struct AppDirsHomeProvider {
+	/// Store the home directory of uid in home and return 0, else return the errno value. May block.
+	int (*lookup)(uid_t uid, std::string& home, void* context) = nullptr;
+	/// Passed to lookup as is.
+	void* context = nullptr;
+
+	AppDirsHomeProvider() = default;
+	AppDirsHomeProvider(int (*lookup_)(uid_t, std::string&, void*), void* context_)
+	    : lookup(lookup_), context(context_) {}
+};
+
+
+/// <summary>
+/// Return the default provider, querying the name service switch with getpwuid_r.
+/// </summary>
+AppDirsHomeProvider appdirs_home_provider_nss();
+
+
+/// <summary>
+/// Return a provider reading a passwd(5) file directly, bypassing NSS backends such as LDAP or SSSD.
+/// </summary>
+/// <param name="path"> is the file to read, which must outlive the provider.
+/// </param>
+AppDirsHomeProvider appdirs_home_provider_passwd_file(const char* path = "/etc/passwd");
+
+
+/// <summary>
+/// Return a provider that never finds a home directory, so only $HOME and the fallback are used.
+/// </summary>
+AppDirsHomeProvider appdirs_home_provider_none();
+
+
+/// <summary>
+/// How the home directory is found when $HOME is not set, see appdirs_set_identity.
+/// </summary>
+struct AppDirsIdentityOptions {
+	/// Provider to query, the NSS provider if lookup is NULL.
+	AppDirsHomeProvider provider;
+	/// Longest time a resolver waits for the provider, 0 to wait until it returns.
+	/// <para/>With a timeout, the provider runs on its own thread and a late result is kept for later calls.
+	/// Only one query runs per user at a time; callers arriving meanwhile wait on it.
+	unsigned timeout_ms = 0;
+	/// Start looking up the home directory of the current user at once, in the background.
+	bool prefetch = false;
+	/// Time a failed lookup is remembered before the provider is queried again for the same user.
+	unsigned retry_ms = 5000;
+	/// Home directory used when the provider fails or times out, copied by appdirs_set_identity.
+	const char* fallback = "~";
+};
+
+
+/// <summary>
+/// Replace how the home directory is found when $HOME is not set.
+/// <![CDATA[
+/// Homes found by the previous provider are no longer used. Typically called
+/// once at startup with prefetch, so the lookup overlaps initialization and a
+/// stalled LDAP or SSSD backend cannot block resolvers for longer than the
+/// timeout.
+/// ]]>
+/// </summary>
+void appdirs_set_identity(const AppDirsIdentityOptions& options);
+#endif
+
+
+/// <summary>
+/// Counters and latency histograms of the library, returned by appdirs_stats_snapshot.
+/// <![CDATA[
+/// Only collected when the library is built with the AppDirsCPP_STATS CMake
+/// option (APPDIRS_STATS defined), otherwise enabled is false and everything
+/// is zero. Histogram bucket i counts durations of [2^i, 2^(i+1)) nanoseconds.
+/// ]]>
+/// </summary>
+struct AppDirsStats {
+	enum counter {
+		user_data_dir_calls,
+		site_data_dir_calls,
+		user_config_dir_calls,
+		site_config_dir_calls,
+		user_cache_dir_calls,
+		user_state_dir_calls,
+		user_log_dir_calls,
+		user_runtime_dir_calls,
+		resolve_all_calls,
+		/// Lookups in the process environment.
+		getenv_calls,
+		/// User directories taken from an XDG_*_HOME variable.
+		xdg_override,
+		/// Home directory taken from $HOME.
+		home_env,
+		/// Home directory taken from the password database.
+		home_passwd,
+		/// Home directory not found, "~" used.
+		home_fallback,
+		/// Runtime directory not taken from $XDG_RUNTIME_DIR.
+		runtime_fallback,
+		/// Password database queries, excluding memoized results.
+		nss_lookups,
+		/// Full path strings that had to grow.
+		allocations,
+		/// Bytes written to full paths, in strings or buffers.
+		bytes_built,
+		counter_count
+	};
+	enum histogram {
+		/// Password database queries.
+		nss_lookup_ns,
+		/// Snapshots built by cached mode.
+		layout_snapshot_ns,
+		histogram_count
+	};
+	static const int bucket_count = 32;
+
+	bool enabled = false;
+	uint64_t counters[counter_count] = {};
+	uint64_t histograms[histogram_count][bucket_count] = {};
+};
+
+
+/// <summary>
+/// Return a copy of the counters and histograms, e.g. to export to a metrics system.
+/// </summary>
+AppDirsStats appdirs_stats_snapshot();
+
+
+/// <summary>
+/// Reset every counter and histogram to zero.
+/// </summary>
+void appdirs_stats_reset();
+
+
+/// <summary>
+/// Options for resolve_all, see the parameter of the same name for each function.
+/// </summary>
+struct AppDirsOptions {
+	/// user_data_dir, user_config_dir, and user_state_dir.
+	bool roaming = false;
+	/// site_data_dir and site_config_dir.
+	bool multipath = false;
+	/// user_cache_dir and user_log_dir.
+	bool opinion = true;
+};
+
+
+namespace appdirs_detail {
+struct app_dirs_access;
+} // namespace appdirs_detail
+
+/// <summary>
+/// Full paths of every directory for an application, returned by resolve_all.
+/// <para/>All paths are stored in a single buffer.
+/// </summary>
+class AppDirs {
+public:
+	enum dir {
+		user_data,
+		site_data,
+		user_config,
+		site_config,
+		user_cache,
+		user_state,
+		user_log,
+		dir_count
+	};
+
+	/// <summary>
+	/// Return the null-terminated full path, or an empty string if it failed to resolve.
+	/// <para/>Site directories with multipath=true are joined by path separator.
+	/// </summary>
+	const _CXTCHAR* get(const dir id) const
+	{
+		return buffer_.c_str() + offsets_[id];
+	}
+
+	/// <summary>
+	/// Return the length of the full path, excluding null terminator.
+	/// </summary>
+	size_t length(const dir id) const
+	{
+		return lengths_[id];
+	}
+
+	/// <summary>
+	/// Return the full path as a new string.
+	/// </summary>
+	_CXTSTR str(const dir id) const
+	{
+		return buffer_.substr(offsets_[id], lengths_[id]);
+	}
+
+private:
+	friend struct appdirs_detail::app_dirs_access;
+
+	_CXTSTR buffer_;
+	size_t offsets_[dir_count] = {};
+	size_t lengths_[dir_count] = {};
+};
+
+
+/// <summary>
+/// Resolve every directory of an application at once.
+/// <![CDATA[
+/// Same results as calling user_data_dir, site_data_dir, user_config_dir,
+/// site_config_dir, user_cache_dir, user_state_dir, and user_log_dir, except
+/// the environment and home directory are only looked up once, and all paths
+/// are written to a single buffer.
+/// ]]>
+/// </summary>
+/// <param name="appname"> is the name of the application.<br/>
+/// <para/>&#160;&#160;&#160;&#160;If NULL, just the system directory is returned.
+/// </param>
+/// <param name="appauthor"> (only used on Windows) is the name of the
+/// <para/>&#160;&#160;&#160;&#160;appauthor or distributing body for this application.
+/// </param>
+/// <param name="version"> is an optional version path element to append to the path.
+/// </param>
+/// <param name="options"> are the roaming, multipath, and opinion flags of each function.
+/// </param>
+/// <param name="error">: If any returned path is empty, check here for the first fault. Assumed using errno method.
+/// </param>
+/// <returns>Return full paths of every directory for this application.</returns>
+AppDirs resolve_all(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const AppDirsOptions& options = AppDirsOptions(),
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as resolve_all, taking appname, appauthor, and version as AppDirsStr.
+/// </summary>
+AppDirs resolve_all(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor = nullptr,
+    const AppDirsStr& version = nullptr,
+    const AppDirsOptions& options = AppDirsOptions(),
+    int* error = nullptr);
+
+
+/// <summary>
+/// Resolve one directory, appending a precomputed suffix instead of appname/appauthor/version.
+/// <![CDATA[
+/// The suffix is appended as is, so it must include any Windows opinion
+/// ("Cache") and leading separators. The "log" or "Logs" opinion of
+/// user_log_dir is still appended when option is true. Used by AppDirsFor.
+/// ]]>
+/// </summary>
+/// <param name="id"> is the directory to resolve.
+/// </param>
+/// <param name="option"> is the roaming, multipath, or opinion flag of the matching function.
+/// </param>
+/// <param name="suffix"> is appended to the base directory, or to each entry for site directories.
+/// </param>
+/// <param name="suffix_length"> is the length of suffix, excluding null terminator.
+/// </param>
+/// <param name="full_path"> receives the full path. Site directories are joined by path separator.
+/// </param>
+/// <param name="error">: If returned length is 0, check here for any faults. Assumed using errno method.
+/// </param>
+/// <returns>Return the number of characters appended, or 0 on failure.</returns>
+size_t resolve_dir(
+    const AppDirs::dir id,
+    const bool option,
+    const _CXTCHAR* suffix,
+    const size_t suffix_length,
+    _CXTSTR& full_path,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as resolve_dir, except the full path is written to a caller-provided buffer.
+/// </summary>
+/// <returns>Return the length of the full path, excluding null terminator. If it is not less than buffer_size, the buffer was too small.</returns>
+size_t resolve_dir(
+    const AppDirs::dir id,
+    const bool option,
+    const _CXTCHAR* suffix,
+    const size_t suffix_length,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error = nullptr);
+
+
+namespace appdirs_detail {
+constexpr size_t length(const _CXTCHAR* str)
+{
+	return *str ? 1 + length(str + 1) : 0;
+}
+
+constexpr _CXTCHAR concat_char(size_t)
+{
+	return 0;
+}
+
+// Return character at index of all strings concatenated.
+template<typename... T>
+constexpr _CXTCHAR concat_char(size_t index, const _CXTCHAR* str, T... rest)
+{
+	return index < length(str) ? str[index] : concat_char(index - length(str), rest...);
+}
+
+constexpr size_t concat_length()
+{
+	return 0;
+}
+
+template<typename... T>
+constexpr size_t concat_length(const _CXTCHAR* str, T... rest)
+{
+	return length(str) + concat_length(rest...);
+}
+
+template<size_t... I>
+struct index_sequence {};
+
+template<size_t N, size_t... I>
+struct make_index_sequence : make_index_sequence<N - 1, N - 1, I...> {};
+
+template<size_t... I>
+struct make_index_sequence<0, I...> {
+	typedef index_sequence<I...> type;
+};
+
+enum suffix_kind {
+	suffix_default,
+	suffix_cache, // includes Windows "Cache" opinion
+	suffix_name   // appname only
+};
+
+// Same as append_path in the library, evaluated at compile time.
+template<const _CXTCHAR* Name, const _CXTCHAR* Author, const _CXTCHAR* Version, suffix_kind Kind>
+struct suffix_parts {
+#if defined(_WIN32)
+#define appdirs_detail_parts                                                                                                          \
+	(Author ? L"\\" : L""), (Author ? Author : L""),                                                                                  \
+	    L"\\", Name,                                                                                                                  \
+	    (Kind == suffix_cache ? L"\\Cache" : L""),                                                                                    \
+	    (Version && Kind != suffix_name ? L"\\" : L""), (Version && Kind != suffix_name ? Version : L"")
+#else
+#define appdirs_detail_parts \
+	"/", Name,               \
+	    (Version && Kind != suffix_name ? "/" : ""), (Version && Kind != suffix_name ? Version : "")
+#endif
+	static constexpr _CXTCHAR at(const size_t index)
+	{
+		return concat_char(index, appdirs_detail_parts);
+	}
+	static constexpr size_t size()
+	{
+		return concat_length(appdirs_detail_parts);
+	}
+#undef appdirs_detail_parts
+};
+
+template<typename Parts, typename Indices = typename make_index_sequence<Parts::size()>::type>
+struct static_suffix;
+
+template<typename Parts, size_t... I>
+struct static_suffix<Parts, index_sequence<I...>> {
+	static constexpr size_t length = sizeof...(I);
+	static constexpr _CXTCHAR value[sizeof...(I) + 1] = { Parts::at(I)..., 0 };
+};
+
+template<typename Parts, size_t... I>
+constexpr _CXTCHAR static_suffix<Parts, index_sequence<I...>>::value[sizeof...(I) + 1];
+} // namespace appdirs_detail
+
+
+/// <summary>
+/// Directories of an application with appname, appauthor, and version known at compile time.
+/// <![CDATA[
+/// The appname/appauthor/version suffix and its length are built at compile
+/// time, so resolving a directory is the base directory lookup plus a single
+/// reservation and copy. Arguments must be character arrays with static
+/// storage, for example:
+///   static constexpr char app_name[] = "MyApp";
+///   static constexpr char app_version[] = "2.1";
+///   typedef AppDirsFor<app_name, nullptr, app_version> MyAppDirs;
+///   std::string cache = MyAppDirs::user_cache_dir();
+/// Site directories with multipath=true are joined by path separator.
+/// ]]>
+/// </summary>
+template<const _CXTCHAR* Name, const _CXTCHAR* Author = nullptr, const _CXTCHAR* Version = nullptr>
+class AppDirsFor {
+	typedef appdirs_detail::static_suffix<appdirs_detail::suffix_parts<Name, Author, Version, appdirs_detail::suffix_default>> suffix;
+#if defined(_WIN32)
+	typedef appdirs_detail::static_suffix<appdirs_detail::suffix_parts<Name, Author, Version, appdirs_detail::suffix_cache>> cache_suffix;
+#else
+	typedef suffix cache_suffix;
+#endif
+#if defined(__APPLE__)
+	typedef appdirs_detail::static_suffix<appdirs_detail::suffix_parts<Name, Author, Version, appdirs_detail::suffix_name>> site_config_suffix;
+#else
+	typedef suffix site_config_suffix;
+#endif
+
+	template<typename Suffix>
+	static _CXTSTR resolve(const AppDirs::dir id, const bool option, int* error)
+	{
+		_CXTSTR full_path;
+		resolve_dir(id, option, Suffix::value, Suffix::length, full_path, error);
+		return full_path;
+	}
+
+public:
+	/// <summary>Return the compile-time appname/appauthor/version suffix.</summary>
+	static constexpr const _CXTCHAR* path_suffix()
+	{
+		return suffix::value;
+	}
+
+	/// <summary>Return the length of path_suffix.</summary>
+	static constexpr size_t path_suffix_length()
+	{
+		return suffix::length;
+	}
+
+	/// <summary>Same as user_data_dir.</summary>
+	static _CXTSTR user_data_dir(const bool roaming = false, int* error = nullptr)
+	{
+		return resolve<suffix>(AppDirs::user_data, roaming, error);
+	}
+
+	/// <summary>Same as site_data_dir, with multiple paths joined by path separator.</summary>
+	static _CXTSTR site_data_dir(const bool multipath = false, int* error = nullptr)
+	{
+		return resolve<suffix>(AppDirs::site_data, multipath, error);
+	}
+
+	/// <summary>Same as user_config_dir.</summary>
+	static _CXTSTR user_config_dir(const bool roaming = false, int* error = nullptr)
+	{
+		return resolve<suffix>(AppDirs::user_config, roaming, error);
+	}
+
+	/// <summary>Same as site_config_dir, with multiple paths joined by path separator.</summary>
+	static _CXTSTR site_config_dir(const bool multipath = false, int* error = nullptr)
+	{
+		return resolve<site_config_suffix>(AppDirs::site_config, multipath, error);
+	}
+
+	/// <summary>Same as user_cache_dir.</summary>
+	static _CXTSTR user_cache_dir(const bool opinion = true, int* error = nullptr)
+	{
+		return opinion ? resolve<cache_suffix>(AppDirs::user_cache, opinion, error)
+		               : resolve<suffix>(AppDirs::user_cache, opinion, error);
+	}
+
+	/// <summary>Same as user_state_dir.</summary>
+	static _CXTSTR user_state_dir(const bool roaming = false, int* error = nullptr)
+	{
+		return resolve<suffix>(AppDirs::user_state, roaming, error);
+	}
+
+	/// <summary>Same as user_log_dir.</summary>
+	static _CXTSTR user_log_dir(const bool opinion = true, int* error = nullptr)
+	{
+		return resolve<suffix>(AppDirs::user_log, opinion, error);
+	}
+};
+
+
+#if !defined(_WIN32)
+/// <summary>
+/// Find the first existing file in the data directory cascade.
+/// <![CDATA[
+/// Search relpath under user_data_dir, then under every site_data_dir with
+/// multipath=true, in order of precedence. The search stops at the first
+/// hit. Each candidate is checked with a single fstatat, or openat and fstat
+/// when fd is requested, and no memory is allocated until a file is found.
+/// Only non-directories count, after following symlinks, so a directory with
+/// the same name does not hide a file further down the cascade.
+/// ]]>
+/// </summary>
+/// <param name="relpath"> is the file path relative to each data directory.
+/// </param>
+/// <param name="appname">, appauthor, and version are the same as user_data_dir.
+/// </param>
+/// <param name="fd"> if not NULL, receives a read-only file descriptor of the file found, or -1. Use close() to release it.
+/// </param>
+/// <param name="error">: If returned path is empty, check here for any faults. ENOENT if not found. Assumed using errno method.
+/// </param>
+/// <returns>Return full path of the first file found, or empty if not found.</returns>
+_CXTSTR find_data_file(
+    const _CXTSTR& relpath,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    int* fd = nullptr,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Find the first existing file in the config directory cascade.
+/// <![CDATA[
+/// Search relpath under user_config_dir, then under every site_config_dir
+/// with multipath=true, in order of precedence. See find_data_file.
+/// ]]>
+/// </summary>
+/// <returns>Return full path of the first file found, or empty if not found.</returns>
+_CXTSTR find_config_file(
+    const _CXTSTR& relpath,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    int* fd = nullptr,
+    int* error = nullptr);
+#endif
+
+
+#if !defined(_WIN32)
+/// <summary>
+/// Same as user_data_dir, then create the directory and any missing parents.
+/// <![CDATA[
+/// The directory itself is created first, and parents are only created if it
+/// failed with ENOENT. Missing directories are created with mode 0700, each
+/// relative to its parent's file descriptor. Directories created or found by
+/// this process are remembered, so later calls for the same path only use a
+/// stat to check the directory still exists, and create it again if not.
+/// ]]>
+/// </summary>
+/// <param name="error">: If returned path is empty, check here for any faults. Assumed using errno method.
+/// </param>
+/// <returns>Return full path to the existing user-specific data dir for this application.</returns>
+_CXTSTR ensure_user_data_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_config_dir, then create the directory and any missing parents. See ensure_user_data_dir.
+/// </summary>
+/// <returns>Return full path to the existing directory.</returns>
+_CXTSTR ensure_user_config_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_cache_dir, then create the directory and any missing parents. See ensure_user_data_dir.
+/// </summary>
+/// <returns>Return full path to the existing directory.</returns>
+_CXTSTR ensure_user_cache_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool opinion = true,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_state_dir, then create the directory and any missing parents. See ensure_user_data_dir.
+/// </summary>
+/// <returns>Return full path to the existing directory.</returns>
+_CXTSTR ensure_user_state_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_log_dir, then create the directory and any missing parents. See ensure_user_data_dir.
+/// </summary>
+/// <returns>Return full path to the existing directory.</returns>
+_CXTSTR ensure_user_log_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool opinion = true,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_runtime_dir, then create the directory and any missing parents. See ensure_user_data_dir.
+/// <para/>A missing per-uid directory is created with mode 0700 and checked before it is used.
+/// </summary>
+/// <returns>Return full path to the existing directory.</returns>
+_CXTSTR ensure_user_runtime_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    int* error = nullptr);
+#endif
+
+
+#if !defined(_WIN32)
+/// <summary>
+/// Same as user_data_dir, then return a directory handle for use with openat and similar.
+/// <![CDATA[
+/// The directory is opened with O_PATH | O_DIRECTORY where available, else
+/// O_RDONLY | O_DIRECTORY. Handles are cached by full path and kept open for
+/// the lifetime of the process, so repeated calls do not open the directory
+/// again. Each call checks with fstatat and fstat that the path still names
+/// the same directory as the handle, so a hit costs two stat calls. If the
+/// directory was removed and recreated or replaced, the new one is opened onto
+/// the same handle with dup3, so a handle already returned follows the path and
+/// at most one descriptor is kept per path.
+///
+/// The returned handle is shared by every caller. Callers must not close it.
+/// ]]>
+/// </summary>
+/// <param name="error">: If -1 is returned, check here for any faults. Assumed using errno method.
+/// </param>
+/// <returns>Return directory handle of the user-specific data dir for this application, or -1.</returns>
+int open_user_data_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as site_data_dir, then return a directory handle of the first existing entry. See open_user_data_dir.
+/// </summary>
+/// <param name="error">: If -1 is returned, check here for any faults. Assumed using errno method.
+/// </param>
+/// <returns>Return directory handle of the user-shared data dir for this application, or -1.</returns>
+int open_site_data_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_config_dir, then return a directory handle. See open_user_data_dir.
+/// </summary>
+/// <param name="error">: If -1 is returned, check here for any faults. Assumed using errno method.
+/// </param>
+/// <returns>Return directory handle of the user-specific config dir for this application, or -1.</returns>
+int open_user_config_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as site_config_dir, then return a directory handle of the first existing entry. See open_user_data_dir.
+/// </summary>
+/// <param name="error">: If -1 is returned, check here for any faults. Assumed using errno method.
+/// </param>
+/// <returns>Return directory handle of the user-shared config dir for this application, or -1.</returns>
+int open_site_config_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_cache_dir, then return a directory handle. See open_user_data_dir.
+/// </summary>
+/// <param name="error">: If -1 is returned, check here for any faults. Assumed using errno method.
+/// </param>
+/// <returns>Return directory handle of the user-specific cache dir for this application, or -1.</returns>
+int open_user_cache_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool opinion = true,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_state_dir, then return a directory handle. See open_user_data_dir.
+/// </summary>
+/// <param name="error">: If -1 is returned, check here for any faults. Assumed using errno method.
+/// </param>
+/// <returns>Return directory handle of the user-specific state dir for this application, or -1.</returns>
+int open_user_state_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_log_dir, then return a directory handle. See open_user_data_dir.
+/// </summary>
+/// <param name="error">: If -1 is returned, check here for any faults. Assumed using errno method.
+/// </param>
+/// <returns>Return directory handle of the user-specific log dir for this application, or -1.</returns>
+int open_user_log_dir(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool opinion = true,
+    int* error = nullptr);
+#endif
+
+#if !defined(_WIN32)
+/// <summary>
+/// Environment to resolve directories with, instead of the process environment.
+/// <![CDATA[
+/// Used by the overloads taking an AppDirsEnv, e.g. to resolve directories
+/// for many users or sandboxes at once without calling setenv. Cached mode
+/// is not used for an explicit environment. The environment must outlive the
+/// call.
+/// ]]>
+/// </summary>
+struct AppDirsEnv {
+	/// Return the value of a variable, or NULL if it is not set.
+	const char* (*getenv)(const char* name, const void* context) = nullptr;
+	/// Passed to getenv as is.
+	const void* context = nullptr;
+	/// Home directory. If NULL, $HOME of this environment is used, else "~".
+	const char* home = nullptr;
+
+	AppDirsEnv() = default;
+	AppDirsEnv(const char* (*getenv_)(const char*, const void*), const void* context_, const char* home_ = nullptr)
+	    : getenv(getenv_), context(context_), home(home_) {}
+	/// Look up variables in a map, which must outlive this object.
+	explicit AppDirsEnv(const std::map<std::string, std::string>& variables, const char* home_ = nullptr);
+};
+
+
+/// <summary>
+/// Same as user_data_dir, using the given environment instead of the process environment.
+/// </summary>
+/// <param name="environment"> is the environment variables and home directory to use.
+/// </param>
+/// <returns>Return full path to the user-specific data dir for this application.</returns>
+_CXTSTR user_data_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as site_data_dir, using the given environment instead of the process environment.
+/// </summary>
+/// <param name="environment"> is the environment variables and home directory to use.
+/// </param>
+/// <returns>Return full path to the user-shared data dir for this application.</returns>
+std::vector<_CXTSTR> site_data_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool multipath = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_config_dir, using the given environment instead of the process environment.
+/// </summary>
+/// <param name="environment"> is the environment variables and home directory to use.
+/// </param>
+/// <returns>Return full path to the user-specific config dir for this application.</returns>
+_CXTSTR user_config_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as site_config_dir, using the given environment instead of the process environment.
+/// </summary>
+/// <param name="environment"> is the environment variables and home directory to use.
+/// </param>
+/// <returns>Return full path to the user-shared config dir for this application.</returns>
+std::vector<_CXTSTR> site_config_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool multipath = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_cache_dir, using the given environment instead of the process environment.
+/// </summary>
+/// <param name="environment"> is the environment variables and home directory to use.
+/// </param>
+/// <returns>Return full path to the user-specific cache dir for this application.</returns>
+_CXTSTR user_cache_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool opinion = true,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_state_dir, using the given environment instead of the process environment.
+/// </summary>
+/// <param name="environment"> is the environment variables and home directory to use.
+/// </param>
+/// <returns>Return full path to the user-specific state dir for this application.</returns>
+_CXTSTR user_state_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool roaming = false,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_log_dir, using the given environment instead of the process environment.
+/// </summary>
+/// <param name="environment"> is the environment variables and home directory to use.
+/// </param>
+/// <returns>Return full path to the user-specific log dir for this application.</returns>
+_CXTSTR user_log_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const bool opinion = true,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as user_runtime_dir, using the given environment instead of the process environment.
+/// </summary>
+/// <param name="environment"> is the environment variables and home directory to use.
+/// </param>
+/// <returns>Return full path to the user-specific runtime dir for this application.</returns>
+_CXTSTR user_runtime_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    int* error = nullptr);
+
+
+/// <summary>
+/// Same as resolve_all, using the given environment instead of the process environment.
+/// </summary>
+/// <param name="environment"> is the environment variables and home directory to use.
+/// </param>
+/// <returns>Return full paths of every directory for this application.</returns>
+AppDirs resolve_all(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const AppDirsOptions& options = AppDirsOptions(),
+    int* error = nullptr);
+
+
+/// <summary>
+/// Directories of one account in the password database, returned by resolve_all_users.
+/// </summary>
+struct UserAppDirs {
+	/// User ID of the account.
+	uid_t uid;
+	/// Login name of the account.
+	std::string name;
+	/// Full paths, resolved with the account's home directory and no environment variables.
+	AppDirs dirs;
+};
+
+
+/// <summary>
+/// Resolve every directory of an application for every account in the password database.
+/// <![CDATA[
+/// The password database is read once with getpwent_r, and each account is
+/// resolved as resolve_all with an empty AppDirsEnv and its home directory,
+/// i.e. the default layout since other users' environment is not known.
+/// Meant for daemons running as root, e.g. backup agents.
+/// ]]>
+/// </summary>
+/// <param name="appname"> is the name of the application.<br/>
+/// <para/>&#160;&#160;&#160;&#160;If NULL, just the system directory is returned.
+/// </param>
+/// <param name="appauthor"> (only used on Windows) is the name of the
+/// <para/>&#160;&#160;&#160;&#160;appauthor or distributing body for this application.
+/// </param>
+/// <param name="version"> is an optional version path element to append to the path.
+/// </param>
+/// <param name="options"> are the roaming, multipath, and opinion flags of each function.
+/// </param>
+/// <param name="error">: If the password database could not be read, check here for the fault. Assumed using errno method.
+/// </param>
+/// <returns>Return directories of every account, in password database order.</returns>
+std::vector<UserAppDirs> resolve_all_users(
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const AppDirsOptions& options = AppDirsOptions(),
+    int* error = nullptr);
+#endif
+
+
+#if defined(__linux__)
+/// <summary>
+/// Environment of another running process, read from /proc/&lt;pid&gt;/environ.
+/// <![CDATA[
+/// The environment is read into one buffer and variables are looked up in
+/// place, without copies. If the process has no HOME, the home directory of
+/// the process owner from the password database is used, else "~". Reuse one
+/// object to read many processes, the buffer only grows to the largest
+/// environment.
+/// ]]>
+/// </summary>
+class ProcessEnv {
+public:
+	/// <summary>
+	/// Read the environment of a process, replacing the previous one.
+	/// </summary>
+	/// <param name="pid"> is the process to read.
+	/// </param>
+	/// <returns>Return 0 on success, else the errno value, e.g. ENOENT if the process exited or EACCES.</returns>
+	int read(const pid_t pid);
+
+	/// <summary>
+	/// Return the value of a variable, or NULL if it is not set.
+	/// </summary>
+	const char* get(const char* name) const;
+
+	/// <summary>
+	/// Return the environment to pass to the AppDirsEnv overloads, valid until the next read.
+	/// </summary>
+	AppDirsEnv environment() const
+	{
+		return AppDirsEnv(lookup, this, home_.empty() ? nullptr : home_.c_str());
+	}
+
+	pid_t pid() const
+	{
+		return pid_;
+	}
+
+	/// Owner of the process.
+	uid_t uid() const
+	{
+		return uid_;
+	}
+
+private:
+	static const char* lookup(const char* name, const void* context);
+
+	std::vector<char> buffer_;
+	size_t size_ = 0;
+	pid_t pid_ = 0;
+	uid_t uid_ = 0;
+	// Home of the process owner when the process has no HOME, else empty.
+	std::string home_;
+};
+
+
+/// <summary>
+/// Resolve every directory of an application as seen by each running process.
+/// <![CDATA[
+/// Iterates /proc and calls back with the directories of each process whose
+/// environment can be read; processes that exit or deny access are skipped.
+/// A single environment buffer is reused, so memory stays bounded by the
+/// largest environment.
+/// ]]>
+/// </summary>
+/// <param name="callback"> is called with each process ID and its directories, which are only valid during the call.
+/// </param>
+/// <param name="context"> is passed to callback as is.
+/// </param>
+/// <param name="appname"> is the name of the application.<br/>
+/// <para/>&#160;&#160;&#160;&#160;If NULL, just the system directory is returned.
+/// </param>
+/// <param name="appauthor"> (only used on Windows) is the name of the
+/// <para/>&#160;&#160;&#160;&#160;appauthor or distributing body for this application.
+/// </param>
+/// <param name="version"> is an optional version path element to append to the path.
+/// </param>
+/// <param name="options"> are the roaming, multipath, and opinion flags of each function.
+/// </param>
+/// <returns>Return 0 on success, else the errno value if /proc could not be read.</returns>
+int resolve_all_processes(
+    void (*callback)(pid_t pid, const AppDirs& dirs, void* context),
+    void* context,
+    const _CXTSTR* appname = nullptr,
+    const _CXTSTR* appauthor = nullptr,
+    const _CXTSTR* version = nullptr,
+    const AppDirsOptions& options = AppDirsOptions());
+#endif
+
+
+#if defined(__linux__)
+/// <summary>
+/// A file changed in a directory of the config cascade, reported by ConfigWatcher.
+/// </summary>
+struct ConfigChange {
+	/// level of the change reported when the inotify queue overflowed, with an empty name and IN_Q_OVERFLOW.
+	/// Events were lost, so every directory must be scanned again.
+	static const size_t rescan = static_cast<size_t>(-1);
+
+	/// Precedence of the directory: 0 is user_config_dir, then each entry of site_config_dir with multipath=true.
+	size_t level;
+	/// Name of the file, relative to the directory.
+	std::string name;
+	/// inotify events seen for the file, combined (IN_CLOSE_WRITE, IN_MOVED_TO, IN_MOVED_FROM, IN_DELETE).
+	/// <para/>With an empty name, the change is the directory itself: IN_IGNORED if it was removed
+	/// or moved away, IN_CREATE if it appeared, so its files must be scanned.
+	uint32_t events;
+};
+
+
+/// <summary>
+/// Watch every directory of the config cascade of an application with inotify.
+/// <![CDATA[
+/// Replaces polling user_config_dir and site_config_dir with stat. A missing
+/// directory is watched through its closest existing parent, and watched
+/// itself once it appears. A directory removed or moved away is watched again
+/// the same way. Events are coalesced, so a burst of writes to a file is
+/// reported once. fd() can be added to poll/epoll and becomes readable when
+/// changes are pending.
+/// ]]>
+/// </summary>
+class ConfigWatcher {
+public:
+	ConfigWatcher() = default;
+	ConfigWatcher(const ConfigWatcher&) = delete;
+	ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+	~ConfigWatcher();
+
+	/// <summary>
+	/// Resolve the config cascade and watch each directory, or its closest existing parent, replacing any previous watches.
+	/// </summary>
+	/// <param name="appname"> is the name of the application.<br/>
+	/// <para/>&#160;&#160;&#160;&#160;If NULL, just the system directory is returned.
+	/// </param>
+	/// <param name="appauthor"> (only used on Windows) is the name of the
+	/// <para/>&#160;&#160;&#160;&#160;appauthor or distributing body for this application.
+	/// </param>
+	/// <param name="version"> is an optional version path element to append to the path.
+	/// </param>
+	/// <returns>Return 0 on success, else the errno value if nothing could be watched.</returns>
+	int start(
+	    const _CXTSTR* appname = nullptr,
+	    const _CXTSTR* appauthor = nullptr,
+	    const _CXTSTR* version = nullptr);
+
+	/// <summary>
+	/// Return the inotify descriptor, readable when changes are pending, or -1 if not started.
+	/// </summary>
+	int fd() const
+	{
+		return fd_;
+	}
+
+	/// <summary>
+	/// Return the directories of the cascade in precedence order, indexed by ConfigChange::level.
+	/// </summary>
+	const std::vector<std::string>& directories() const
+	{
+		return directories_;
+	}
+
+	/// <summary>
+	/// Read one batch of pending changes.
+	/// <![CDATA[
+	/// Once the first event arrives, wait coalesce_ms for the rest of the burst,
+	/// then read what is queued with a single read, so a continuous stream of
+	/// events still returns. Events left in the queue are read by the next call.
+	/// ]]>
+	/// </summary>
+	/// <param name="changes"> receives one entry per changed file, in order of first event,
+	/// <para/>&#160;&#160;&#160;&#160;or an entry with level ConfigChange::rescan if events were lost.
+	/// </param>
+	/// <param name="timeout_ms"> is how long to wait for the first event; 0 returns at once, -1 waits forever.
+	/// </param>
+	/// <param name="coalesce_ms"> is how long to wait for more events after the first one.
+	/// </param>
+	/// <returns>Return the number of changes appended.</returns>
+	size_t read_changes(std::vector<ConfigChange>& changes, const int timeout_ms = 0, const int coalesce_ms = 50);
+
+	/// <summary>
+	/// Same as read_changes, calling back for each change instead.
+	/// </summary>
+	size_t read_changes(void (*callback)(const ConfigChange& change, void* context), void* context, const int timeout_ms = 0, const int coalesce_ms = 50);
+
+private:
+	// Watches of one level of the cascade.
+	struct level_watch {
+		// Watch descriptor of the directory, or -1 while it is missing.
+		int watch = -1;
+		// Watch descriptor of the closest existing parent while the directory is missing, or -1.
+		int parent = -1;
+		// Length of the parent path within the directory path.
+		size_t parent_length = 0;
+	};
+
+	void stop();
+	// Watch the directory of level, else its closest existing parent. Return true if the directory is watched.
+	bool watch_level(const size_t level);
+	// Remove a watch descriptor no longer used by any level.
+	void release_watch(const int watch);
+
+	int fd_ = -1;
+	std::vector<std::string> directories_;
+	std::vector<level_watch> watches_;
+};
+#endif
+
+
+#if defined(__linux__)
+/// <summary>
+/// Index of the files of an application's data directories, with user_data_dir shadowing site_data_dir.
+/// <![CDATA[
+/// Each directory of user_data_dir and site_data_dir with multipath=true is
+/// read once with getdents64, and every name maps to the path in the
+/// directory of highest precedence. Only the immediate entries of each
+/// directory are indexed; use subdir to index e.g. "icons" or "plugins".
+/// refresh only reads directories whose modification time changed, and
+/// generation is increased whenever the index changes.
+/// ]]>
+/// </summary>
+class DataIndex {
+public:
+	struct entry {
+		/// Full path of the winning file.
+		std::string path;
+		/// Precedence of its directory: 0 is user_data_dir, then each entry of site_data_dir.
+		size_t level;
+	};
+
+	/// <summary>
+	/// Resolve the data directories and read each of them.
+	/// </summary>
+	/// <param name="appname"> is the name of the application.<br/>
+	/// <para/>&#160;&#160;&#160;&#160;If NULL, just the system directory is returned.
+	/// </param>
+	/// <param name="appauthor"> (only used on Windows) is the name of the
+	/// <para/>&#160;&#160;&#160;&#160;appauthor or distributing body for this application.
+	/// </param>
+	/// <param name="version"> is an optional version path element to append to the path.
+	/// </param>
+	/// <param name="subdir"> is an optional relative directory to index inside each data directory.
+	/// </param>
+	/// <returns>Return 0 on success, else the errno value of the first directory that failed to read other than ENOENT.</returns>
+	int build(
+	    const _CXTSTR* appname = nullptr,
+	    const _CXTSTR* appauthor = nullptr,
+	    const _CXTSTR* version = nullptr,
+	    const _CXTSTR* subdir = nullptr);
+
+	/// <summary>
+	/// Read again only the directories that changed since the last build or refresh.
+	/// </summary>
+	/// <returns>Return 0 on success, else the errno value of the first directory that failed to read other than ENOENT.</returns>
+	int refresh();
+
+	/// <summary>
+	/// Return the winning full path of name, or NULL if no directory has it.
+	/// </summary>
+	const char* find(const std::string& name) const
+	{
+		const auto found = entries_.find(name);
+		return found != entries_.end() ? found->second.path.c_str() : nullptr;
+	}
+
+	/// <summary>
+	/// Return every indexed name with its winning entry.
+	/// </summary>
+	const std::unordered_map<std::string, entry>& entries() const
+	{
+		return entries_;
+	}
+
+	/// <summary>
+	/// Return the directories in precedence order, indexed by entry::level.
+	/// </summary>
+	const std::vector<std::string>& directories() const
+	{
+		return paths_;
+	}
+
+	/// <summary>
+	/// Return a counter increased each time the index changes.
+	/// </summary>
+	uint64_t generation() const
+	{
+		return generation_;
+	}
+
+private:
+	struct directory {
+		std::string path;
+		// Modification time when last read, zero if missing.
+		int64_t mtime_sec;
+		int64_t mtime_nsec;
+		std::vector<std::string> names;
+	};
+
+	int scan(const bool force);
+
+	std::vector<directory> dirs_;
+	std::vector<std::string> paths_;
+	std::unordered_map<std::string, entry> entries_;
+	uint64_t generation_ = 0;
+};
+#endif
+
+
+#if defined(__linux__)
+/// <summary>
+/// Keep an application's user_cache_dir within a byte and entry budget, evicting least recently used files.
+/// <![CDATA[
+/// open scans the cache directory in parallel with statx, one subdirectory
+/// per thread, and orders every file by access time. Afterwards the cache is
+/// tracked in memory: call record after writing a file and touch after using
+/// one. When the budget is exceeded, a background thread removes the least
+/// recently used files. The log directory is skipped when user_log_dir is
+/// inside user_cache_dir. Sizes are apparent file sizes.
+/// ]]>
+/// </summary>
+class CacheManager {
+public:
+	CacheManager();
+	CacheManager(const CacheManager&) = delete;
+	CacheManager& operator=(const CacheManager&) = delete;
+	~CacheManager();
+
+	/// <summary>
+	/// Create user_cache_dir if missing, scan it, and start background eviction.
+	/// </summary>
+	/// <param name="appname"> is the name of the application.<br/>
+	/// <para/>&#160;&#160;&#160;&#160;If NULL, just the system directory is returned.
+	/// </param>
+	/// <param name="appauthor"> (only used on Windows) is the name of the
+	/// <para/>&#160;&#160;&#160;&#160;appauthor or distributing body for this application.
+	/// </param>
+	/// <param name="version"> is an optional version path element to append to the path.
+	/// </param>
+	/// <param name="max_bytes"> is the total size budget, 0 for no limit.
+	/// </param>
+	/// <param name="max_entries"> is the file count budget, 0 for no limit.
+	/// </param>
+	/// <param name="scan_threads"> is the number of threads used to scan, 0 for the number of hardware threads.
+	/// </param>
+	/// <returns>Return 0 on success, else the errno value.</returns>
+	int open(
+	    const _CXTSTR* appname,
+	    const _CXTSTR* appauthor,
+	    const _CXTSTR* version,
+	    const uint64_t max_bytes,
+	    const size_t max_entries = 0,
+	    const unsigned scan_threads = 0);
+
+	/// <summary>
+	/// Stop background eviction and forget every file. Files are kept on disk.
+	/// </summary>
+	void close();
+
+	/// <summary>
+	/// Return the cache directory, empty if not open.
+	/// </summary>
+	const std::string& directory() const;
+
+	/// <summary>
+	/// Add or update a file after writing it, making it the most recently used.
+	/// </summary>
+	/// <param name="name"> is the path of the file relative to directory().
+	/// </param>
+	/// <returns>Return 0 on success, else the errno value of statx.</returns>
+	int record(const std::string& name);
+
+	/// <summary>
+	/// Mark a file as the most recently used, without any system call.
+	/// </summary>
+	/// <returns>Return true if the file is tracked.</returns>
+	bool touch(const std::string& name);
+
+	/// <summary>
+	/// Remove least recently used files until within budget, without waiting for the background thread.
+	/// </summary>
+	/// <returns>Return the number of files removed.</returns>
+	size_t evict();
+
+	/// <summary>
+	/// Return the total size of tracked files.
+	/// </summary>
+	uint64_t bytes() const;
+
+	/// <summary>
+	/// Return the number of tracked files.
+	/// </summary>
+	size_t entries() const;
+
+private:
+	struct impl;
+	std::unique_ptr<impl> impl_;
+};
+#endif
+
+
+#if defined(__linux__)
+/// <summary>
+/// Asynchronous log file in an application's user_log_dir.
+/// <![CDATA[
+/// Each producer thread appends to its own lock-free ring buffer, and a
+/// background thread writes out every ring in batches with writev. write
+/// only waits when the ring of the calling thread is full. Lines of one
+/// thread keep their order, lines of different threads are interleaved by
+/// batch. With max_file_bytes, the file is rotated to name.1 .. name.N in
+/// the same directory before a batch would exceed it. close waits for
+/// writes in progress, later writes return false. open must not run
+/// concurrently with write. The ring of a thread is freed once the thread
+/// has exited and its data is written out.
+/// ]]>
+/// </summary>
+class LogWriter {
+public:
+	LogWriter();
+	LogWriter(const LogWriter&) = delete;
+	LogWriter& operator=(const LogWriter&) = delete;
+	~LogWriter();
+
+	/// <summary>
+	/// Create user_log_dir if missing, open the log file for appending, and start the flusher thread.
+	/// </summary>
+	/// <param name="appname"> is the name of the application.<br/>
+	/// <para/>&#160;&#160;&#160;&#160;If NULL, just the system directory is returned.
+	/// </param>
+	/// <param name="appauthor"> (only used on Windows) is the name of the
+	/// <para/>&#160;&#160;&#160;&#160;appauthor or distributing body for this application.
+	/// </param>
+	/// <param name="version"> is an optional version path element to append to the path.
+	/// </param>
+	/// <param name="file_name"> is the name of the log file inside the directory.
+	/// </param>
+	/// <param name="max_file_bytes"> is the size to rotate the file at, 0 to never rotate.
+	/// </param>
+	/// <param name="max_files"> is the number of files kept including the current one.
+	/// </param>
+	/// <param name="ring_bytes"> is the buffer size of each producer thread, rounded up to a power of two.
+	/// </param>
+	/// <param name="flush_interval_ms"> is how often the flusher thread writes out pending data.
+	/// </param>
+	/// <returns>Return 0 on success, else the errno value.</returns>
+	int open(
+	    const _CXTSTR* appname,
+	    const _CXTSTR* appauthor,
+	    const _CXTSTR* version,
+	    const std::string& file_name,
+	    const uint64_t max_file_bytes = 0,
+	    const unsigned max_files = 5,
+	    const size_t ring_bytes = 65536,
+	    const unsigned flush_interval_ms = 100);
+
+	/// <summary>
+	/// Write out everything pending, stop the flusher thread, and close the file.
+	/// </summary>
+	void close();
+
+	/// <summary>
+	/// Append data to the log, e.g. one line including its newline.
+	/// </summary>
+	/// <returns>Return false if not open or length is larger than the ring buffer.</returns>
+	bool write(const char* data, const size_t length);
+
+	/// <summary>
+	/// Wait until everything appended so far is written to the file.
+	/// </summary>
+	void flush();
+
+	/// <summary>
+	/// Return the log directory, empty if not open.
+	/// </summary>
+	const std::string& directory() const;
+
+	/// <summary>
+	/// Return the errno value of the last failed write, rotation, or 0.
+	/// </summary>
+	int error() const;
+
+	/// <summary>
+	/// Return the number of ring buffers allocated, one per producer thread still running or not yet drained.
+	/// </summary>
+	size_t buffers() const;
+
+private:
+	struct impl;
+	std::unique_ptr<impl> impl_;
+};
+#endif
+
+
+#if defined(__linux__)
+/// <summary>
+/// Crash-safe key-value store for small state in an application's user_state_dir.
+/// <![CDATA[
+/// Stored as name.db, read with mmap when opened, plus name.journal. set and
+/// erase update memory at once, so get never makes a system call; commit
+/// appends the pending updates to the journal with one write and one
+/// fdatasync. When the journal grows past compact_bytes, a background thread
+/// rewrites name.db and starts a new journal. A record torn by a crash is
+/// detected by its checksum and dropped when opened.
+/// ]]>
+/// </summary>
+class StateStore {
+public:
+	StateStore();
+	StateStore(const StateStore&) = delete;
+	StateStore& operator=(const StateStore&) = delete;
+	~StateStore();
+
+	/// <summary>
+	/// Create user_state_dir if missing, then load the store.
+	/// </summary>
+	/// <param name="appname"> is the name of the application.<br/>
+	/// <para/>&#160;&#160;&#160;&#160;If NULL, just the system directory is returned.
+	/// </param>
+	/// <param name="appauthor"> (only used on Windows) is the name of the
+	/// <para/>&#160;&#160;&#160;&#160;appauthor or distributing body for this application.
+	/// </param>
+	/// <param name="version"> is an optional version path element to append to the path.
+	/// </param>
+	/// <param name="name"> is the file name of the store, without extension.
+	/// </param>
+	/// <param name="compact_bytes"> is the journal size to compact at, 0 to only compact when asked.
+	/// </param>
+	/// <returns>Return 0 on success, else the errno value.</returns>
+	int open(
+	    const _CXTSTR* appname,
+	    const _CXTSTR* appauthor,
+	    const _CXTSTR* version,
+	    const std::string& name,
+	    const uint64_t compact_bytes = 65536);
+
+	/// <summary>
+	/// Commit pending updates and close the store.
+	/// </summary>
+	void close();
+
+	/// <summary>
+	/// Copy the value of key.
+	/// </summary>
+	/// <returns>Return false if key is not set.</returns>
+	bool get(const std::string& key, std::string& value) const;
+
+	/// <summary>
+	/// Set the value of key, written to disk by the next commit.
+	/// </summary>
+	void set(const std::string& key, const std::string& value);
+
+	/// <summary>
+	/// Remove key, written to disk by the next commit.
+	/// </summary>
+	void erase(const std::string& key);
+
+	/// <summary>
+	/// Append pending updates to the journal with one write and one fdatasync.
+	/// </summary>
+	/// <returns>Return 0 on success, else the errno value.</returns>
+	int commit();
+
+	/// <summary>
+	/// Commit, then rewrite the data file and start a new journal, without waiting for the background thread.
+	/// </summary>
+	/// <returns>Return 0 on success, else the errno value.</returns>
+	int compact();
+
+	/// <summary>
+	/// Return the number of keys.
+	/// </summary>
+	size_t size() const;
+
+	/// <summary>
+	/// Return the state directory, empty if not open.
+	/// </summary>
+	const std::string& directory() const;
+
+private:
+	struct impl;
+	std::unique_ptr<impl> impl_;
+};
+#endif
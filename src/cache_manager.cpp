@@ -0,0 +1,345 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include "AppDirsCPP.hpp"
+
+#if defined(__linux__)
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct scanned_file {
+	std::string name;
+	uint64_t size;
+	int64_t atime_ns;
+};
+
+struct file_info {
+	bool is_dir;
+	bool is_file;
+	uint64_t size;
+	int64_t atime_ns;
+};
+
+// Type, size, and access time of name relative to dir_fd, without following symlinks. Returns 0 or the errno value.
+int stat_file(const int dir_fd, const char* name, file_info& info)
+{
+#if defined(STATX_TYPE)
+	struct statx stx;
+	if (statx(dir_fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE | STATX_ATIME, &stx)) {
+		return errno;
+	}
+	info.is_dir = S_ISDIR(stx.stx_mode);
+	info.is_file = S_ISREG(stx.stx_mode);
+	info.size = stx.stx_size;
+	info.atime_ns = static_cast<int64_t>(stx.stx_atime.tv_sec) * 1000000000 + stx.stx_atime.tv_nsec;
+#else
+	struct stat st;
+	if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW)) {
+		return errno;
+	}
+	info.is_dir = S_ISDIR(st.st_mode);
+	info.is_file = S_ISREG(st.st_mode);
+	info.size = static_cast<uint64_t>(st.st_size);
+	info.atime_ns = static_cast<int64_t>(st.st_atim.tv_sec) * 1000000000 + st.st_atim.tv_nsec;
+#endif
+	return 0;
+}
+
+inline bool is_dot(const char* name)
+{
+	return name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]));
+}
+
+// Walk a directory, taking ownership of dir_fd. Names are relative to the cache directory.
+void scan_tree(const int dir_fd, const std::string& prefix, const std::string& skip, std::vector<scanned_file>& files)
+{
+	DIR* dir = fdopendir(dir_fd);
+	if (!dir) {
+		close(dir_fd);
+		return;
+	}
+	dirent* entry;
+	while ((entry = readdir(dir))) {
+		if (is_dot(entry->d_name)) {
+			continue;
+		}
+		std::string name = prefix + entry->d_name;
+		file_info info;
+		if (name == skip || stat_file(dirfd(dir), entry->d_name, info)) {
+			continue;
+		}
+		if (info.is_dir) {
+			const int child_fd = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+			if (child_fd >= 0) {
+				scan_tree(child_fd, name + "/", skip, files);
+			}
+		}
+		else if (info.is_file) {
+			files.push_back({ std::move(name), info.size, info.atime_ns });
+		}
+	}
+	closedir(dir);
+}
+
+} // namespace
+
+struct CacheManager::impl {
+	struct entry {
+		std::string name;
+		uint64_t size;
+	};
+
+	std::string directory;
+	int dir_fd = -1;
+	uint64_t max_bytes = 0;
+	size_t max_entries = 0;
+
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::thread evictor;
+	bool stopping = false;
+
+	uint64_t bytes = 0;
+	// Most recently used first.
+	std::list<entry> lru;
+	std::unordered_map<std::string, std::list<entry>::iterator> index;
+
+	bool over_budget() const
+	{
+		return (max_bytes && bytes > max_bytes) || (max_entries && lru.size() > max_entries);
+	}
+
+	size_t evict()
+	{
+		size_t removed = 0;
+		// Unlink with the lock held, else a record of the same name between
+		// removing the entry and unlinking would lose the new file.
+		std::lock_guard<std::mutex> lock(mutex);
+		while (over_budget()) {
+			const entry& victim = lru.back();
+			unlinkat(dir_fd, victim.name.c_str(), 0);
+			index.erase(victim.name);
+			bytes -= victim.size;
+			lru.pop_back();
+			removed++;
+		}
+		return removed;
+	}
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [this]() { return stopping || over_budget(); });
+			if (stopping) {
+				return;
+			}
+			lock.unlock();
+			evict();
+			lock.lock();
+		}
+	}
+};
+
+CacheManager::CacheManager()
+    : impl_(new impl) {}
+
+CacheManager::~CacheManager()
+{
+	close();
+}
+
+void CacheManager::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(impl_->mutex);
+		impl_->stopping = true;
+	}
+	impl_->wake.notify_all();
+	if (impl_->evictor.joinable()) {
+		impl_->evictor.join();
+	}
+	if (impl_->dir_fd >= 0) {
+		::close(impl_->dir_fd);
+		impl_->dir_fd = -1;
+	}
+	impl_->directory.clear();
+	impl_->lru.clear();
+	impl_->index.clear();
+	impl_->bytes = 0;
+	impl_->stopping = false;
+}
+
+int CacheManager::open(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const uint64_t max_bytes,
+    const size_t max_entries,
+    const unsigned scan_threads)
+{
+	close();
+	int error = 0;
+	std::string directory = ensure_user_cache_dir(appname, appauthor, version, true, &error);
+	if (directory.empty()) {
+		return error ? error : ENOENT;
+	}
+	const int dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir_fd < 0) {
+		return errno;
+	}
+
+	// Log files are not cache entries, skip user_log_dir when it is inside.
+	std::string skip;
+	const std::string log_dir = user_log_dir(appname, appauthor, version, true);
+	if (log_dir.compare(0, directory.length() + 1, directory + "/") == 0) {
+		skip = log_dir.substr(directory.length() + 1);
+	}
+
+	// Files at the top are collected here, each subdirectory is walked by one of the threads.
+	std::vector<scanned_file> files;
+	std::vector<std::string> subdirs;
+	const int list_fd = dup(dir_fd);
+	DIR* dir = list_fd >= 0 ? fdopendir(list_fd) : nullptr;
+	if (!dir) {
+		error = errno;
+		if (list_fd >= 0) {
+			::close(list_fd);
+		}
+		::close(dir_fd);
+		return error;
+	}
+	dirent* entry;
+	while ((entry = readdir(dir))) {
+		file_info info;
+		if (is_dot(entry->d_name) || entry->d_name == skip || stat_file(dir_fd, entry->d_name, info)) {
+			continue;
+		}
+		if (info.is_dir) {
+			subdirs.push_back(entry->d_name);
+		}
+		else if (info.is_file) {
+			files.push_back({ entry->d_name, info.size, info.atime_ns });
+		}
+	}
+	closedir(dir);
+
+	unsigned thread_count = scan_threads ? scan_threads : std::thread::hardware_concurrency();
+	thread_count = static_cast<unsigned>(std::min<size_t>(std::max(thread_count, 1u), std::max<size_t>(subdirs.size(), 1)));
+	std::vector<std::vector<scanned_file>> thread_files(thread_count);
+	std::atomic<size_t> next_subdir(0);
+	const auto scan_subdirs = [&](const unsigned thread) {
+		size_t i;
+		while ((i = next_subdir++) < subdirs.size()) {
+			const int child_fd = openat(dir_fd, subdirs[i].c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+			if (child_fd >= 0) {
+				scan_tree(child_fd, subdirs[i] + "/", skip, thread_files[thread]);
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for (unsigned thread = 1; thread < thread_count; thread++) {
+		threads.emplace_back(scan_subdirs, thread);
+	}
+	scan_subdirs(0);
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	for (std::vector<scanned_file>& scanned : thread_files) {
+		std::move(scanned.begin(), scanned.end(), std::back_inserter(files));
+	}
+
+	std::sort(files.begin(), files.end(), [](const scanned_file& a, const scanned_file& b) { return a.atime_ns > b.atime_ns; });
+	impl_->directory = std::move(directory);
+	impl_->dir_fd = dir_fd;
+	impl_->max_bytes = max_bytes;
+	impl_->max_entries = max_entries;
+	for (scanned_file& file : files) {
+		impl_->bytes += file.size;
+		impl_->lru.push_back({ std::move(file.name), file.size });
+		impl_->index[impl_->lru.back().name] = std::prev(impl_->lru.end());
+	}
+	impl_->evictor = std::thread(&impl::run, impl_.get());
+	return 0;
+}
+
+const std::string& CacheManager::directory() const
+{
+	return impl_->directory;
+}
+
+int CacheManager::record(const std::string& name)
+{
+	if (impl_->dir_fd < 0) {
+		return EBADF;
+	}
+	// Stat with the lock held, so eviction cannot unlink the file before it is indexed.
+	std::lock_guard<std::mutex> lock(impl_->mutex);
+	file_info info;
+	const int rc = stat_file(impl_->dir_fd, name.c_str(), info);
+	const auto found = impl_->index.find(name);
+	if (found != impl_->index.end()) {
+		impl_->bytes -= found->second->size;
+		if (rc) {
+			impl_->lru.erase(found->second);
+			impl_->index.erase(found);
+			return rc;
+		}
+		found->second->size = info.size;
+		impl_->lru.splice(impl_->lru.begin(), impl_->lru, found->second);
+	}
+	else if (rc) {
+		return rc;
+	}
+	else {
+		impl_->lru.push_front({ name, info.size });
+		impl_->index[name] = impl_->lru.begin();
+	}
+	impl_->bytes += info.size;
+	if (impl_->over_budget()) {
+		impl_->wake.notify_one();
+	}
+	return 0;
+}
+
+bool CacheManager::touch(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex);
+	const auto found = impl_->index.find(name);
+	if (found == impl_->index.end()) {
+		return false;
+	}
+	impl_->lru.splice(impl_->lru.begin(), impl_->lru, found->second);
+	return true;
+}
+
+size_t CacheManager::evict()
+{
+	return impl_->dir_fd >= 0 ? impl_->evict() : 0;
+}
+
+uint64_t CacheManager::bytes() const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex);
+	return impl_->bytes;
+}
+
+size_t CacheManager::entries() const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex);
+	return impl_->lru.size();
+}
+#endif
@@ -0,0 +1,419 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include "AppDirsCPP.hpp"
+
+#if defined(__linux__)
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+// Bytes written by one producer thread and read by the flusher thread.
+struct log_ring {
+	std::vector<char> data;
+	size_t mask;
+	// Written by the producer, total bytes ever appended.
+	std::atomic<size_t> head;
+	// Written by the flusher, total bytes ever written out.
+	std::atomic<size_t> tail;
+	std::thread::id owner;
+	// Set when the owner thread exits, the flusher frees the ring once drained.
+	std::atomic<bool> orphaned;
+
+	log_ring(const size_t capacity, const std::thread::id owner_)
+	    : data(capacity), mask(capacity - 1), head(0), tail(0), owner(owner_), orphaned(false) {}
+};
+
+// Rings owned by the calling thread, marked orphaned when it exits.
+struct log_ring_owner {
+	std::vector<std::shared_ptr<log_ring>> rings;
+
+	~log_ring_owner()
+	{
+		for (const auto& ring : rings) {
+			ring->orphaned.store(true, std::memory_order_release);
+		}
+	}
+
+	void add(const std::shared_ptr<log_ring>& ring)
+	{
+		// Forget rings already freed by their writer.
+		rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<log_ring>& owned) { return owned.use_count() == 1; }), rings.end());
+		rings.push_back(ring);
+	}
+};
+thread_local log_ring_owner log_ring_owned;
+
+size_t round_up_pow2(size_t value)
+{
+	size_t result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+std::atomic<uint64_t> log_writer_next_id(1);
+
+// Ring of the calling thread for the last writer it used.
+struct log_ring_cache {
+	uint64_t writer_id;
+	log_ring* ring;
+};
+thread_local log_ring_cache log_ring_last = { 0, nullptr };
+
+} // namespace
+
+struct LogWriter::impl {
+	// 0 while closed. write only uses the rings while it is counted in writers.
+	std::atomic<uint64_t> id;
+	std::atomic<unsigned> writers;
+	int dir_fd = -1;
+	int fd = -1;
+	std::string directory;
+	std::string file_name;
+	uint64_t max_file_bytes = 0;
+	unsigned max_files = 0;
+	size_t ring_bytes = 0;
+	std::chrono::milliseconds interval;
+	uint64_t file_bytes = 0;
+
+	// Rings are only added while open, and freed by close.
+	std::mutex rings_mutex;
+	std::vector<std::shared_ptr<log_ring>> rings;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable flushed;
+	bool stopping = false;
+	std::thread flusher;
+	std::atomic<int> error;
+	// Used by the flusher thread only, kept to avoid allocating on each pass.
+	std::vector<log_ring*> drain_rings;
+	std::vector<size_t> drain_heads;
+
+	impl()
+	    : id(0), writers(0), interval(0), error(0) {}
+
+	log_ring* ring_for_thread(const uint64_t writer_id)
+	{
+		if (log_ring_last.writer_id == writer_id) {
+			return log_ring_last.ring;
+		}
+		const std::thread::id self = std::this_thread::get_id();
+		std::lock_guard<std::mutex> lock(rings_mutex);
+		log_ring* ring = nullptr;
+		for (const auto& existing : rings) {
+			if (existing->owner == self) {
+				ring = existing.get();
+				break;
+			}
+		}
+		if (!ring) {
+			rings.emplace_back(std::make_shared<log_ring>(ring_bytes, self));
+			log_ring_owned.add(rings.back());
+			ring = rings.back().get();
+		}
+		log_ring_last = { writer_id, ring };
+		return ring;
+	}
+
+	int open_file()
+	{
+		fd = openat(dir_fd, file_name.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+		if (fd < 0) {
+			return errno;
+		}
+		struct stat st;
+		file_bytes = fstat(fd, &st) ? 0 : static_cast<uint64_t>(st.st_size);
+		return 0;
+	}
+
+	// Shift name.1 .. name.(max_files - 1) up by one, then move name to name.1.
+	void rotate()
+	{
+		::close(fd);
+		fd = -1;
+		for (unsigned n = max_files - 1; n > 0; n--) {
+			const std::string from = n > 1 ? file_name + "." + std::to_string(n - 1) : file_name;
+			const std::string to = file_name + "." + std::to_string(n);
+			renameat(dir_fd, from.c_str(), dir_fd, to.c_str());
+		}
+		if (max_files <= 1) {
+			unlinkat(dir_fd, file_name.c_str(), 0);
+		}
+		const int rc = open_file();
+		if (rc) {
+			error = rc;
+		}
+	}
+
+	// Write out everything pending in every ring. Returns the number of bytes written.
+	size_t drain()
+	{
+		std::vector<log_ring*>& snapshot = drain_rings;
+		snapshot.clear();
+		{
+			std::lock_guard<std::mutex> lock(rings_mutex);
+			for (const auto& ring : rings) {
+				snapshot.push_back(ring.get());
+			}
+		}
+
+		size_t written = 0;
+		iovec iov[IOV_MAX < 1024 ? IOV_MAX : 1024];
+		size_t ring_index = 0;
+		while (ring_index < snapshot.size()) {
+			// Gather up to two pieces per ring, as the pending bytes may wrap around.
+			int iov_count = 0;
+			size_t batch_bytes = 0;
+			const size_t first_ring = ring_index;
+			std::vector<size_t>& heads = drain_heads;
+			heads.clear();
+			while (ring_index < snapshot.size() && iov_count + 2 <= static_cast<int>(sizeof(iov) / sizeof(iov[0]))) {
+				log_ring& ring = *snapshot[ring_index++];
+				const size_t head = ring.head.load(std::memory_order_acquire);
+				const size_t tail = ring.tail.load(std::memory_order_relaxed);
+				heads.push_back(head);
+				if (head == tail) {
+					continue;
+				}
+				const size_t start = tail & ring.mask;
+				const size_t pending = head - tail;
+				const size_t first = std::min(pending, ring.data.size() - start);
+				iov[iov_count++] = { ring.data.data() + start, first };
+				if (pending > first) {
+					iov[iov_count++] = { ring.data.data(), pending - first };
+				}
+				batch_bytes += pending;
+			}
+			if (!batch_bytes) {
+				continue;
+			}
+
+			if (max_file_bytes && file_bytes && file_bytes + batch_bytes > max_file_bytes) {
+				rotate();
+			}
+			if (fd >= 0) {
+				write_all(iov, iov_count);
+				file_bytes += batch_bytes;
+			}
+			// Release the space even if writing failed, so producers are never stuck.
+			for (size_t i = first_ring; i < ring_index; i++) {
+				snapshot[i]->tail.store(heads[i - first_ring], std::memory_order_release);
+			}
+			written += batch_bytes;
+		}
+		free_orphaned_rings();
+		return written;
+	}
+
+	// Free the drained rings of exited threads, so thread churn does not grow memory.
+	void free_orphaned_rings()
+	{
+		std::lock_guard<std::mutex> lock(rings_mutex);
+		rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<log_ring>& ring) {
+			return ring->orphaned.load(std::memory_order_acquire) && ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire);
+		}), rings.end());
+	}
+
+	void write_all(iovec* iov, int iov_count)
+	{
+		while (iov_count > 0) {
+			ssize_t count = writev(fd, iov, iov_count);
+			if (count < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				error = errno;
+				return;
+			}
+			// Skip what was written after a short write.
+			while (iov_count > 0 && static_cast<size_t>(count) >= iov->iov_len) {
+				count -= iov->iov_len;
+				iov++;
+				iov_count--;
+			}
+			if (iov_count > 0) {
+				iov->iov_base = static_cast<char*>(iov->iov_base) + count;
+				iov->iov_len -= count;
+			}
+		}
+	}
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			const bool stop = stopping;
+			lock.unlock();
+			drain();
+			lock.lock();
+			flushed.notify_all();
+			if (stop) {
+				return;
+			}
+			wake.wait_for(lock, interval);
+		}
+	}
+
+	bool rings_empty()
+	{
+		std::lock_guard<std::mutex> lock(rings_mutex);
+		for (const auto& ring : rings) {
+			if (ring->tail.load(std::memory_order_acquire) != ring->head.load(std::memory_order_acquire)) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+LogWriter::LogWriter()
+    : impl_(new impl) {}
+
+LogWriter::~LogWriter()
+{
+	close();
+}
+
+int LogWriter::open(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const std::string& file_name,
+    const uint64_t max_file_bytes,
+    const unsigned max_files,
+    const size_t ring_bytes,
+    const unsigned flush_interval_ms)
+{
+	close();
+	if (file_name.empty() || file_name.find('/') != std::string::npos) {
+		return EINVAL;
+	}
+	int error = 0;
+	std::string directory = ensure_user_log_dir(appname, appauthor, version, true, &error);
+	if (directory.empty()) {
+		return error ? error : ENOENT;
+	}
+	impl_->dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (impl_->dir_fd < 0) {
+		return errno;
+	}
+	impl_->directory = std::move(directory);
+	impl_->file_name = file_name;
+	impl_->max_file_bytes = max_file_bytes;
+	impl_->max_files = max_files;
+	impl_->ring_bytes = round_up_pow2(ring_bytes ? ring_bytes : 1);
+	impl_->interval = std::chrono::milliseconds(flush_interval_ms ? flush_interval_ms : 1);
+	error = impl_->open_file();
+	if (error) {
+		close();
+		return error;
+	}
+	impl_->id = log_writer_next_id++;
+	impl_->error = 0;
+	impl_->flusher = std::thread(&impl::run, impl_.get());
+	return 0;
+}
+
+void LogWriter::close()
+{
+	// Stop new writes, then wait for writes in progress before freeing the rings.
+	impl_->id = 0;
+	while (impl_->writers.load() != 0) {
+		impl_->wake.notify_one();
+		std::this_thread::yield();
+	}
+	if (impl_->flusher.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(impl_->mutex);
+			impl_->stopping = true;
+		}
+		impl_->wake.notify_all();
+		impl_->flusher.join();
+		impl_->stopping = false;
+	}
+	if (impl_->fd >= 0) {
+		::close(impl_->fd);
+		impl_->fd = -1;
+	}
+	if (impl_->dir_fd >= 0) {
+		::close(impl_->dir_fd);
+		impl_->dir_fd = -1;
+	}
+	// A new id on open makes every thread look up its ring again.
+	impl_->rings.clear();
+	impl_->directory.clear();
+}
+
+bool LogWriter::write(const char* data, const size_t length)
+{
+	// Counted before id is read, so close either sees this write or this write sees id 0.
+	impl_->writers++;
+	const uint64_t id = impl_->id.load();
+	if (!id || length > impl_->ring_bytes) {
+		impl_->writers--;
+		return false;
+	}
+	log_ring& ring = *impl_->ring_for_thread(id);
+	const size_t head = ring.head.load(std::memory_order_relaxed);
+	// Wait for the flusher only when the ring is full.
+	while (head + length - ring.tail.load(std::memory_order_acquire) > ring.data.size()) {
+		impl_->wake.notify_one();
+		std::this_thread::yield();
+	}
+	const size_t start = head & ring.mask;
+	const size_t first = std::min(length, ring.data.size() - start);
+	memcpy(ring.data.data() + start, data, first);
+	memcpy(ring.data.data(), data + first, length - first);
+	ring.head.store(head + length, std::memory_order_release);
+	if (head + length - ring.tail.load(std::memory_order_relaxed) > ring.data.size() / 2) {
+		impl_->wake.notify_one();
+	}
+	impl_->writers--;
+	return true;
+}
+
+void LogWriter::flush()
+{
+	if (!impl_->flusher.joinable()) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(impl_->mutex);
+	while (!impl_->rings_empty()) {
+		impl_->wake.notify_one();
+		impl_->flushed.wait_for(lock, impl_->interval);
+	}
+}
+
+const std::string& LogWriter::directory() const
+{
+	return impl_->directory;
+}
+
+int LogWriter::error() const
+{
+	return impl_->error;
+}
+
+size_t LogWriter::buffers() const
+{
+	std::lock_guard<std::mutex> lock(impl_->rings_mutex);
+	return impl_->rings.size();
+}
+#endif
@@ -9,20 +9,130 @@
 #include <cstdint>
 #include <string>
 #include <cerrno>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <map>
+#include <algorithm>
 
-static inline void splitMultiPath(
-    _CXTSTR multipath,
-    std::vector<_CXTSTR>& full_paths)
+#if defined(APPDIRS_STATS)
+#include <chrono>
+
+// Counters and histograms, only updated with relaxed atomics.
+static std::atomic<uint64_t> stats_counters[AppDirsStats::counter_count];
+static std::atomic<uint64_t> stats_histograms[AppDirsStats::histogram_count][AppDirsStats::bucket_count];
+
+static inline void stats_count(const AppDirsStats::counter id, const uint64_t value = 1)
+{
+	stats_counters[id].fetch_add(value, std::memory_order_relaxed);
+}
+
+// Records the time from construction to destruction into a histogram.
+class stats_timer {
+public:
+	explicit stats_timer(const AppDirsStats::histogram id)
+	    : id_(id), start_(std::chrono::steady_clock::now()) {}
+	~stats_timer()
+	{
+		const uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+		int bucket = 0;
+		while (bucket + 1 < AppDirsStats::bucket_count && (ns >> (bucket + 1))) {
+			bucket++;
+		}
+		stats_histograms[id_][bucket].fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	AppDirsStats::histogram id_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+#define APPDIRS_STAT_COUNT(id) stats_count(AppDirsStats::id)
+#define APPDIRS_STAT_ADD(id, value) stats_count(AppDirsStats::id, value)
+#define APPDIRS_STAT_TIMER(id) stats_timer stats_timer_##id(AppDirsStats::id)
+#else
+#define APPDIRS_STAT_COUNT(id) ((void)0)
+#define APPDIRS_STAT_ADD(id, value) ((void)0)
+#define APPDIRS_STAT_TIMER(id) ((void)0)
+#endif
+
+AppDirsStats appdirs_stats_snapshot()
+{
+	AppDirsStats stats;
+#if defined(APPDIRS_STATS)
+	stats.enabled = true;
+	for (int id = 0; id < AppDirsStats::counter_count; id++) {
+		stats.counters[id] = stats_counters[id].load(std::memory_order_relaxed);
+	}
+	for (int id = 0; id < AppDirsStats::histogram_count; id++) {
+		for (int bucket = 0; bucket < AppDirsStats::bucket_count; bucket++) {
+			stats.histograms[id][bucket] = stats_histograms[id][bucket].load(std::memory_order_relaxed);
+		}
+	}
+#endif
+	return stats;
+}
+
+void appdirs_stats_reset()
+{
+#if defined(APPDIRS_STATS)
+	for (auto& counter : stats_counters) {
+		counter.store(0, std::memory_order_relaxed);
+	}
+	for (auto& histogram : stats_histograms) {
+		for (auto& bucket : histogram) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+	}
+#endif
+}
+
+// View into a path list entry, without copying it.
+struct path_view {
+	const _CXTCHAR* str;
+	size_t length;
+};
+
+// Get the next entry of multipath at cursor, then move cursor past it.
+// Return false when no entries are left.
+static inline bool nextMultiPath(
+    const _CXTCHAR*& cursor,
+    path_view& entry)
+{
+	if (!cursor) {
+		return false;
+	}
+	const _CXTCHAR separator = pathsep[0];
+	const _CXTCHAR* entry_end = cursor;
+	while (*entry_end && *entry_end != separator) {
+		entry_end++;
+	}
+	entry.str = cursor;
+	entry.length = static_cast<size_t>(entry_end - cursor);
+	cursor = *entry_end ? entry_end + 1 : nullptr;
+	return true;
+}
+
+// Return the number of entries of multipath, including empty ones.
+static inline size_t countMultiPath(const _CXTCHAR* multipath)
 {
-	size_t pos = 0;
-	size_t counter = 0;
-	while ((pos = multipath.find(pathsep_cstr, pos)) != _CXTSTR::npos) {
-		counter++;
-		full_paths.push_back(multipath.substr(0, pos));
-		multipath.erase(0, pos + pathsep_cstr.length());
+	size_t count = 1;
+	for (const _CXTCHAR* i = multipath; *i; i++) {
+		count += (*i == pathsep[0]);
 	}
-	if (counter == 0) {
-		full_paths.push_back(multipath);
+	return count;
+}
+
+// Split multipath in linear time, views are pointing into multipath.
+static inline void splitMultiPath(
+    const _CXTCHAR* multipath,
+    std::vector<path_view>& entries)
+{
+	entries.reserve(entries.size() + countMultiPath(multipath));
+
+	path_view entry;
+	while (nextMultiPath(multipath, entry)) {
+		entries.push_back(entry);
 	}
 }
 
@@ -57,391 +167,3327 @@ static inline void wins_getFolderPath(
 #else
 #include <pwd.h>
 #include <unistd.h>
-static _CXTSTR getUserDirectory()
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
+static int nss_home_lookup(const uid_t uid, std::string& home, void*)
 {
-	const char* path = getenv("HOME");
-	if (path) {
-		return path;
+	long buffer_size = sysconf(_SC_GETPW_R_SIZE_MAX);
+	std::vector<char> buffer(buffer_size > 0 ? static_cast<size_t>(buffer_size) : 1024);
+	passwd pw;
+	passwd* result = nullptr;
+	int rc;
+	while ((rc = getpwuid_r(uid, &pw, buffer.data(), buffer.size(), &result)) == ERANGE) {
+		buffer.resize(buffer.size() * 2);
 	}
-	const passwd* pw = getpwuid(getuid());
+	if (!result || !pw.pw_dir) {
+		return rc ? rc : ENOENT;
+	}
+	home = pw.pw_dir;
+	return 0;
+}
 
-	if (pw) {
-		return pw->pw_dir;
+static int passwd_file_home_lookup(const uid_t uid, std::string& home, void* context)
+{
+	std::ifstream file(static_cast<const char*>(context));
+	if (!file) {
+		return errno ? errno : ENOENT;
+	}
+	// name:password:uid:gid:gecos:home:shell
+	std::string line;
+	while (std::getline(file, line)) {
+		size_t field_start = 0;
+		std::string fields[6];
+		for (int field = 0; field < 6 && field_start <= line.length(); field++) {
+			const size_t field_end = std::min(line.find(':', field_start), line.length());
+			fields[field] = line.substr(field_start, field_end - field_start);
+			field_start = field_end + 1;
+		}
+		// Skip a line whose uid is not a number in range.
+		if (fields[2].empty() || fields[2].find_first_not_of("0123456789") != std::string::npos) {
+			continue;
+		}
+		char* end;
+		errno = 0;
+		const unsigned long line_uid = strtoul(fields[2].c_str(), &end, 10);
+		if (errno == ERANGE || *end || line_uid > static_cast<uid_t>(-1)) {
+			continue;
+		}
+		if (line_uid == uid) {
+			home = fields[5];
+			return home.empty() ? ENOENT : 0;
+		}
 	}
+	return ENOENT;
+}
 
-	return "~";
+static int none_home_lookup(const uid_t, std::string&, void*)
+{
+	return ENOENT;
 }
-#endif
 
-static _CXTSTR append_path(
-    const _CXTSTR* appname,
-    const _CXTSTR* appauthor,
-    const _CXTSTR* version)
+AppDirsHomeProvider appdirs_home_provider_nss()
 {
-	_CXTSTR append_path_str;
-#if defined(_WIN32) // Only for Windows
-	if (appauthor) {
-		append_path_str.append(slash_cat + *appauthor);
-	}
-#endif
+	return AppDirsHomeProvider(nss_home_lookup, nullptr);
+}
 
-	if (appname) {
-		append_path_str.append(slash_cat + *appname);
-		if (version) {
-			append_path_str.append(slash_cat + *version);
+AppDirsHomeProvider appdirs_home_provider_passwd_file(const char* path)
+{
+	return AppDirsHomeProvider(passwd_file_home_lookup, const_cast<char*>(path));
+}
+
+AppDirsHomeProvider appdirs_home_provider_none()
+{
+	return AppDirsHomeProvider(none_home_lookup, nullptr);
+}
+
+// Result of the identity provider for one uid, dropped when the provider is
+// replaced. A failure is kept until retry_after, so a failing backend is not
+// queried on every call.
+struct passwd_home {
+	int rc;
+	std::string home;
+	std::chrono::steady_clock::time_point retry_after;
+};
+// A provider query in progress. Only one runs per uid, whatever the provider,
+// so a stalled backend holds at most one thread per uid. Guarded by identity_state::mutex.
+struct home_lookup {
+	uid_t uid;
+	uint64_t generation;
+	bool done = false;
+	int rc = 0;
+	std::string home;
+};
+// Identity state, guarded by mutex. Never freed, as a detached lookup may still run after main returns.
+struct identity_state {
+	std::mutex mutex;
+	std::condition_variable done_cv;
+	std::unordered_map<uid_t, passwd_home> passwd_homes;
+	std::vector<std::shared_ptr<home_lookup>> home_lookups;
+	AppDirsHomeProvider provider = appdirs_home_provider_nss();
+	unsigned timeout_ms = 0;
+	unsigned retry_ms = 5000;
+	std::string fallback = "~";
+	// Incremented by appdirs_set_identity, so results of a replaced provider are dropped.
+	uint64_t generation = 0;
+};
+static identity_state& identity()
+{
+	static identity_state* const state = new identity_state();
+	return *state;
+}
+
+static void run_home_lookup(const std::shared_ptr<home_lookup> lookup, const AppDirsHomeProvider provider)
+{
+	std::string home;
+	int rc;
+	{
+		APPDIRS_STAT_COUNT(nss_lookups);
+		APPDIRS_STAT_TIMER(nss_lookup_ns);
+		rc = provider.lookup(lookup->uid, home, provider.context);
+	}
+	identity_state& state = identity();
+	std::lock_guard<std::mutex> lock(state.mutex);
+	if (lookup->generation == state.generation) {
+		passwd_home& entry = state.passwd_homes[lookup->uid];
+		entry.rc = rc;
+		entry.home = home;
+		entry.retry_after = std::chrono::steady_clock::now() + std::chrono::milliseconds(state.retry_ms);
+	}
+	for (auto pending = state.home_lookups.begin(); pending != state.home_lookups.end(); ++pending) {
+		if (*pending == lookup) {
+			state.home_lookups.erase(pending);
+			break;
 		}
 	}
-	return append_path_str;
+	lookup->done = true;
+	lookup->rc = rc;
+	lookup->home = std::move(home);
+	state.done_cv.notify_all();
 }
 
-static _CXTSTR append_path_cache(
-    const _CXTSTR* appname,
-    const _CXTSTR* appauthor,
-    const _CXTSTR* version,
-    bool opinion)
+// Return the pending lookup of uid, or start one with the current provider,
+// on its own thread if async. Requires identity_state::mutex.
+static std::shared_ptr<home_lookup> start_home_lookup(identity_state& state, const uid_t uid, const bool async, bool& started)
 {
-	_CXTSTR append_path_str;
-#if defined(_WIN32) // Only for Windows
-	if (appauthor) {
-		append_path_str.append(slash_cat + *appauthor);
+	started = false;
+	for (const auto& pending : state.home_lookups) {
+		if (pending->uid == uid) {
+			return pending;
+		}
 	}
-#endif
-
-	if (appname) {
-		append_path_str.append(slash_cat + *appname);
+	std::shared_ptr<home_lookup> lookup(new home_lookup());
+	lookup->uid = uid;
+	lookup->generation = state.generation;
+	state.home_lookups.push_back(lookup);
+	started = true;
+	if (async) {
+		std::thread(run_home_lookup, lookup, state.provider).detach();
+	}
+	return lookup;
+}
 
-#if defined(_WIN32) // Only for Windows
-		if (opinion) {
-			append_path_str.append(slash_cat cache_str);
+// Copy the home directory of uid from the identity provider to home.
+// Returns 0 on success, else the error of the provider, or ETIMEDOUT.
+static int getPasswdDirectory(const uid_t uid, std::string& home)
+{
+	identity_state& state = identity();
+	std::unique_lock<std::mutex> lock(state.mutex);
+	// Without a timeout, the caller queries the provider itself and others wait for it.
+	const bool bounded = state.timeout_ms != 0;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(state.timeout_ms);
+	while (true) {
+		const auto found = state.passwd_homes.find(uid);
+		if (found != state.passwd_homes.end() && (!found->second.rc || std::chrono::steady_clock::now() < found->second.retry_after)) {
+			if (!found->second.rc) {
+				home = found->second.home;
+			}
+			return found->second.rc;
 		}
-#endif
 
-		if (version) {
-			append_path_str.append(slash_cat + *version);
+		bool started;
+		const std::shared_ptr<home_lookup> lookup = start_home_lookup(state, uid, bounded, started);
+		if (started && !bounded) {
+			const AppDirsHomeProvider provider = state.provider;
+			lock.unlock();
+			run_home_lookup(lookup, provider);
+			lock.lock();
+		}
+		const auto finished = [&]() { return lookup->done; };
+		if (!bounded) {
+			state.done_cv.wait(lock, finished);
+		}
+		else if (!state.done_cv.wait_until(lock, deadline, finished)) {
+			return ETIMEDOUT;
+		}
+		// A lookup of a replaced provider only frees the uid for a new one.
+		if (lookup->generation == state.generation) {
+			if (!lookup->rc) {
+				home = lookup->home;
+			}
+			return lookup->rc;
 		}
 	}
-	return append_path_str;
 }
 
-_CXTSTR user_data_dir(
-    const _CXTSTR* appname,
-    const _CXTSTR* appauthor,
-    const _CXTSTR* version,
-    const bool roaming,
-    int* error)
+void appdirs_set_identity(const AppDirsIdentityOptions& options)
 {
-	_CXTSTR full_path;
+	identity_state& state = identity();
+	std::lock_guard<std::mutex> lock(state.mutex);
+	state.provider = options.provider.lookup ? options.provider : appdirs_home_provider_nss();
+	state.timeout_ms = options.timeout_ms;
+	state.retry_ms = options.retry_ms;
+	state.fallback = options.fallback ? options.fallback : "~";
+	state.generation++;
+	state.passwd_homes.clear();
+	if (options.prefetch) {
+		bool started;
+		start_home_lookup(state, getuid(), true, started);
+	}
+}
 
-#if defined(_WIN32)
-	const int csidl = roaming ? CSIDL_APPDATA : CSIDL_LOCAL_APPDATA;
-	const KNOWNFOLDERID rfid = roaming ? FOLDERID_RoamingAppData : FOLDERID_LocalAppData;
-	wins_getFolderPath(csidl, rfid, full_path);
-#elif defined(__APPLE__)
-	full_path = getUserDirectory() + "/Library/Application Support";
-#else
-	const char* path = getenv("XDG_DATA_HOME");
+// The home directory is copied to storage, as appdirs_set_identity may replace it.
+static const char* getUserDirectory(std::string& storage)
+{
+	APPDIRS_STAT_COUNT(getenv_calls);
+	const char* path = getenv("HOME");
 	if (path) {
-		full_path = path;
+		APPDIRS_STAT_COUNT(home_env);
+		return path;
 	}
-	else {
-		full_path = getUserDirectory() + "/.local/share";
+	const int rc = getPasswdDirectory(getuid(), storage);
+	if (!rc) {
+		APPDIRS_STAT_COUNT(home_passwd);
+		return storage.c_str();
 	}
+
+	APPDIRS_STAT_COUNT(home_fallback);
+	std::lock_guard<std::mutex> lock(identity().mutex);
+	storage = identity().fallback;
+	errno = rc;
+	return storage.c_str();
+}
 #endif
 
-	if (full_path.empty()) {
-		if (error) {
-			*error = errno;
-		}
-		return full_path;
+// Pieces of a full path, written out once the total length is known.
+struct path_pieces {
+	struct piece {
+		const _CXTCHAR* str;
+		size_t length;
+	};
+	piece list[12];
+	size_t count = 0;
+	size_t length = 0;
+
+	void add(const _CXTCHAR* str, const size_t str_length)
+	{
+		list[count].str = str;
+		list[count].length = str_length;
+		count++;
+		length += str_length;
+	}
+	void add(const _CXTCHAR* str)
+	{
+		add(str, std::char_traits<_CXTCHAR>::length(str));
 	}
+	void add(const _CXTSTR& str)
+	{
+		add(str.c_str(), str.length());
+	}
+};
 
-	const _CXTSTR& append_path_str = append_path(appname, appauthor, version);
-	if (!append_path_str.empty()) {
-		full_path.append(append_path_str);
+// Destination of a full path, either a caller-provided string or buffer.
+class path_output {
+public:
+	explicit path_output(_CXTSTR& str)
+	    : str_(&str), buffer_(nullptr), buffer_size_(0), length_(0) {}
+	path_output(_CXTCHAR* buffer, const size_t buffer_size)
+	    : str_(nullptr), buffer_(buffer), buffer_size_(buffer_size), length_(0)
+	{
+		if (buffer_ && buffer_size_) {
+			buffer_[0] = 0;
+		}
 	}
 
-	if (error) {
-		*error = 0;
+	void append(const _CXTCHAR* str, const size_t str_length)
+	{
+		APPDIRS_STAT_ADD(bytes_built, str_length * sizeof(_CXTCHAR));
+		if (str_) {
+			if (str_->capacity() < str_->length() + str_length) {
+				APPDIRS_STAT_COUNT(allocations);
+			}
+			str_->append(str, str_length);
+		}
+		// Like snprintf, copy what fits and always leave a null terminator.
+		else if (buffer_ && length_ + 1 < buffer_size_) {
+			const size_t copy_length = std::min(str_length, buffer_size_ - 1 - length_);
+			std::char_traits<_CXTCHAR>::copy(buffer_ + length_, str, copy_length);
+			buffer_[length_ + copy_length] = 0;
+		}
+		length_ += str_length;
+	}
+	void append(const path_pieces& pieces)
+	{
+		if (str_ && str_->capacity() < str_->length() + pieces.length) {
+			APPDIRS_STAT_COUNT(allocations);
+			str_->reserve(str_->length() + pieces.length);
+		}
+		for (size_t i = 0; i < pieces.count; i++) {
+			append(pieces.list[i].str, pieces.list[i].length);
+		}
+	}
+	size_t length() const
+	{
+		return length_;
 	}
-	return full_path;
-}
 
-std::vector<_CXTSTR> site_data_dir(
-    const _CXTSTR* appname,
-    const _CXTSTR* appauthor,
-    const _CXTSTR* version,
-    const bool multipath,
-    int* error)
+private:
+	_CXTSTR* str_;
+	_CXTCHAR* buffer_;
+	size_t buffer_size_;
+	size_t length_;
+};
+
+static void append_path(
+    path_pieces& pieces,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool cache_opinion = false)
 {
-	std::vector<_CXTSTR> full_paths;
+#if defined(_WIN32) // Only for Windows
+	if (appauthor) {
+		pieces.add(slash_cat);
+		pieces.add(appauthor.data, appauthor.length);
+	}
+#endif
 
-#if defined(_WIN32)
-	_CXTSTR path;
-	wins_getFolderPath(CSIDL_COMMON_APPDATA, FOLDERID_ProgramData, path);
-	if (!path.empty()) {
-		full_paths.push_back(path);
+	if (appname) {
+		pieces.add(slash_cat);
+		pieces.add(appname.data, appname.length);
+
+#if defined(_WIN32) // Only for Windows
+		if (cache_opinion) {
+			pieces.add(slash_cat cache_str);
+		}
+#endif
+
+		if (version) {
+			pieces.add(slash_cat);
+			pieces.add(version.data, version.length);
+		}
 	}
-#elif defined(__APPLE__)
-	full_paths.push_back("/Library/Application Support");
-#else
-	const char* paths = getenv("XDG_DATA_DIRS");
-	if (paths) {
-		splitMultiPath(paths, full_paths);
+}
+
+// Base directories before any appname/appauthor/version suffix is appended.
+enum base_dir_id {
+	base_user_data_local,
+	base_user_data_roaming,
+	base_user_config,
+	base_user_cache,
+	base_user_state,
+	base_user_log,
+	base_user_runtime,
+	base_dir_count
+};
+
+// Snapshot of every base directory, taken once when cached mode is enabled.
+struct layout_snapshot {
+	_CXTSTR base_dirs[base_dir_count];
+	// Site directory lists for data and config, joined by path separator.
+	_CXTSTR site_dir_lists[2];
+	bool site_dir_found[2];
+};
+
+// Resolved base directory; head is NULL if the lookup failed.
+struct base_dir {
+	const _CXTCHAR* head = nullptr;
+	const _CXTCHAR* tail = _CXT("");
+	// Keep head alive while it points into storage.
+	_CXTSTR storage;
+};
+
+struct layout_reader;
+static const layout_snapshot* acquire_layout_snapshot(layout_reader*& reader);
+static void release_layout_snapshot(layout_reader* reader);
+
+// Environment lookups shared by several base directories.
+struct env_context {
+	// Snapshot of cached mode, held until the call returns so appdirs_refresh cannot free it.
+	const layout_snapshot* layout_ = nullptr;
+	layout_reader* layout_reader_ = nullptr;
+	bool layout_acquired = false;
+
+	env_context(const env_context&) = delete;
+	env_context& operator=(const env_context&) = delete;
+	~env_context()
+	{
+		release_layout_snapshot(layout_reader_);
 	}
-	else {
-		full_paths.push_back("/usr/local/share");
-		full_paths.push_back("/usr/share");
+	const layout_snapshot* layout()
+	{
+		if (!layout_acquired) {
+			layout_acquired = true;
+			layout_ = acquire_layout_snapshot(layout_reader_);
+		}
+		return layout_;
 	}
 
-	if (full_paths.empty()) {
-		if (error) {
-			*error = errno;
+#if !defined(_WIN32)
+	// Explicit environment, or NULL for the process environment.
+	const AppDirsEnv* source;
+	const char* home = nullptr;
+	std::string home_storage;
+
+	explicit env_context(const AppDirsEnv* source_ = nullptr)
+	    : source(source_) {}
+
+	bool is_process() const
+	{
+		return !source;
+	}
+	const char* get(const char* name) const
+	{
+		if (source) {
+			return source->getenv ? source->getenv(name, source->context) : nullptr;
 		}
-		return full_paths;
+		APPDIRS_STAT_COUNT(getenv_calls);
+		return getenv(name);
+	}
+	const char* get_home()
+	{
+		if (!home) {
+			if (!source) {
+				home = getUserDirectory(home_storage);
+			}
+			else if (source->home) {
+				home = source->home;
+			}
+			else {
+				home = get("HOME");
+				if (!home) {
+					home = "~";
+				}
+			}
+		}
+		return home;
 	}
+#else
+	env_context() = default;
 
-	if (!multipath) {
-		full_paths.resize(1);
+	bool is_process() const
+	{
+		return true;
 	}
 #endif
+};
 
-	if (full_paths.empty()) {
-		if (error) {
-			*error = errno;
-		}
-		return full_paths;
-	}
+#if !defined(_WIN32) && !defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// Return true if path is a directory owned by uid with mode 0700, with a single fstatat.
+static bool is_private_dir(const char* path, const uid_t uid, const int flags)
+{
+	struct stat st;
+	return !fstatat(AT_FDCWD, path, &st, flags) && S_ISDIR(st.st_mode) && st.st_uid == uid && (st.st_mode & 0777) == 0700;
+}
 
-	_CXTSTR append_path_str = append_path(appname, appauthor, version);
-	if (!append_path_str.empty()) {
-		for (auto& full_path_i : full_paths) {
-			full_path_i.append(append_path_str);
+// Use $XDG_RUNTIME_DIR if it is private to the user, else a per-uid directory
+// under /dev/shm or /tmp. The per-uid directory is not created here, only by
+// ensure_user_runtime_dir. The owner of an explicit environment is unknown, so
+// its directories are not checked.
+static void lookup_runtime_dir(base_dir& base, env_context& env)
+{
+	const uid_t uid = getuid();
+	const bool check = env.is_process();
+	const char* runtime = env.get("XDG_RUNTIME_DIR");
+	if (runtime && runtime[0] == '/' && (!check || is_private_dir(runtime, uid, 0))) {
+		APPDIRS_STAT_COUNT(xdg_override);
+		base.head = runtime;
+		return;
+	}
+	APPDIRS_STAT_COUNT(runtime_fallback);
+	const char* roots[] = { "/dev/shm", "/tmp" };
+	for (const char* root : roots) {
+		base.storage = root;
+		base.storage += "/runtime-";
+		base.storage += std::to_string(uid);
+		// Never follow a symlink, or use a directory left by another user.
+		errno = 0;
+		if (!check || is_private_dir(base.storage.c_str(), uid, AT_SYMLINK_NOFOLLOW) || (errno == ENOENT && !access(root, W_OK | X_OK))) {
+			base.head = base.storage.c_str();
+			return;
 		}
 	}
+	errno = EACCES;
+}
 
-	if (error) {
-		*error = 0;
+// Create the per-uid directory of lookup_runtime_dir if full_path is inside it.
+static int make_runtime_dir(const _CXTSTR& full_path)
+{
+	env_context env;
+	base_dir base;
+	lookup_runtime_dir(base, env);
+	if (!base.head) {
+		return errno;
 	}
-	return full_paths;
+	if (base.head != base.storage.c_str() || full_path.compare(0, base.storage.length(), base.storage) != 0) {
+		return 0;
+	}
+	// The umask may have cleared bits of a directory created here.
+	if (!mkdir(base.head, 0700)) {
+		chmod(base.head, 0700);
+	}
+	return is_private_dir(base.head, getuid(), AT_SYMLINK_NOFOLLOW) ? 0 : EACCES;
 }
+#endif
 
-_CXTSTR user_config_dir(
-    const _CXTSTR* appname,
-    const _CXTSTR* appauthor,
-    const _CXTSTR* version,
-    const bool roaming,
-    int* error)
+static void lookup_base_dir(base_dir_id id, base_dir& base, env_context& env)
 {
 #if defined(_WIN32)
-	// same as user_data_dir
-	return user_data_dir(appname, appauthor, version, roaming, error);
+	switch (id) {
+		case base_user_data_roaming:
+			wins_getFolderPath(CSIDL_APPDATA, FOLDERID_RoamingAppData, base.storage);
+			break;
+		default:
+			wins_getFolderPath(CSIDL_LOCAL_APPDATA, FOLDERID_LocalAppData, base.storage);
+			break;
+	}
+	if (!base.storage.empty()) {
+		base.head = base.storage.c_str();
+	}
+	if (id == base_user_runtime) {
+		base.tail = L"\\Temp";
+	}
 #elif defined(__APPLE__)
-	_CXTSTR full_path = getUserDirectory() + "/Library/Preferences";
+	base.head = env.get_home();
+	switch (id) {
+		case base_user_config:
+			base.tail = "/Library/Preferences";
+			break;
+		case base_user_cache:
+			base.tail = "/Library/Caches";
+			break;
+		case base_user_log:
+			base.tail = "/Library/Logs";
+			break;
+		case base_user_runtime:
+			base.tail = "/Library/Caches/TemporaryItems";
+			break;
+		default:
+			base.tail = "/Library/Application Support";
+			break;
+	}
 #else
-	_CXTSTR full_path;
-
-	const char* path = getenv("XDG_CONFIG_HOME");
-	if (path) {
-		full_path = path;
+	if (id == base_user_runtime) {
+		lookup_runtime_dir(base, env);
+		return;
+	}
+	const char* env_name;
+	const char* fallback;
+	switch (id) {
+		case base_user_config:
+			env_name = "XDG_CONFIG_HOME";
+			fallback = "/.config";
+			break;
+		case base_user_cache:
+		case base_user_log:
+			env_name = "XDG_CACHE_HOME";
+			fallback = "/.cache";
+			break;
+		case base_user_state:
+			env_name = "XDG_STATE_HOME";
+			fallback = "/.local/state";
+			break;
+		default:
+			env_name = "XDG_DATA_HOME";
+			fallback = "/.local/share";
+			break;
+	}
+	base.head = env.get(env_name);
+	if (base.head) {
+		APPDIRS_STAT_COUNT(xdg_override);
 	}
 	else {
-		full_path = getUserDirectory() + "/.config";
+		base.head = env.get_home();
+		base.tail = fallback;
 	}
 #endif
-#if !defined(_WIN32)
-	if (full_path.empty()) {
-		if (error) {
-			*error = errno;
-		}
-		return full_path;
+	// Keep same behavior as an empty environment variable.
+	if (base.head && base.head[0] == 0 && base.tail[0] == 0) {
+		base.head = nullptr;
 	}
+}
 
-	const _CXTSTR& append_path_str = append_path(appname, nullptr, version);
-	if (!append_path_str.empty()) {
-		full_path.append(append_path_str);
-	}
+#if !defined(_WIN32) && !defined(__APPLE__)
+#include <sys/stat.h>
+#include <climits>
+#include <set>
 
-	if (error) {
-		*error = 0;
+static std::atomic<bool> site_dirs_canonical(false);
+
+// Real path and identity of a site directory, looked up once until appdirs_refresh.
+struct canonical_dir {
+	bool found;
+	std::string path;
+	dev_t dev;
+	ino_t ino;
+};
+static std::mutex canonical_dirs_mutex;
+static std::unordered_map<std::string, canonical_dir> canonical_dirs;
+
+static canonical_dir get_canonical_dir(const std::string& entry)
+{
+	{
+		std::lock_guard<std::mutex> lock(canonical_dirs_mutex);
+		const auto found = canonical_dirs.find(entry);
+		if (found != canonical_dirs.end()) {
+			return found->second;
+		}
 	}
-	return full_path;
-#endif
+	canonical_dir result = { false, std::string(), 0, 0 };
+	char resolved[PATH_MAX];
+	struct stat st;
+	if (realpath(entry.c_str(), resolved) && !stat(resolved, &st)) {
+		result.found = true;
+		result.path = resolved;
+		result.dev = st.st_dev;
+		result.ino = st.st_ino;
+	}
+	std::lock_guard<std::mutex> lock(canonical_dirs_mutex);
+	canonical_dirs.emplace(entry, result);
+	return result;
 }
 
-std::vector<_CXTSTR> site_config_dir(
-    const _CXTSTR* appname,
-    const _CXTSTR* appauthor,
-    const _CXTSTR* version,
-    const bool multipath,
-    int* error)
+// Return true if entry is absolute, without empty or "." components, or a trailing slash.
+static bool is_normal_entry(const path_view& entry)
 {
-#if defined(_WIN32)
-	// same as site_data_dir
-	return site_data_dir(appname, appauthor, version, multipath, error);
-#elif defined(__APPLE__)
-	std::vector<_CXTSTR> full_paths;
-	full_paths.push_back("/Library/Preferences");
-
-	const _CXTSTR& append_path_str = append_path(appname, nullptr, nullptr);
-	if (!append_path_str.empty()) {
-		for (auto& full_path_i : full_paths) {
-			full_path_i.append(append_path_str);
+	if (!entry.length || entry.str[0] != '/') {
+		return false;
+	}
+	size_t start = 1;
+	while (start < entry.length) {
+		size_t end = start;
+		while (end < entry.length && entry.str[end] != '/') {
+			end++;
+		}
+		const size_t length = end - start;
+		if (!length || end == entry.length - 1 || (length == 1 && entry.str[start] == '.')) {
+			return false;
 		}
+		start = end + 1;
 	}
-	return full_paths;
-#else
-	std::vector<_CXTSTR> full_paths;
+	return true;
+}
 
-	const char* paths = getenv("XDG_CONFIG_DIRS");
-	if (paths) {
-		splitMultiPath(paths, full_paths);
+// Write entry without empty or "." components, or a trailing slash. Return false for a relative entry.
+static bool normalize_entry(const path_view& entry, std::string& normal)
+{
+	normal.clear();
+	if (!entry.length || entry.str[0] != '/') {
+		return false;
 	}
-	else {
-		full_paths.push_back("/etc/xdg");
+	normal.push_back('/');
+	size_t start = 1;
+	while (start < entry.length) {
+		size_t end = start;
+		while (end < entry.length && entry.str[end] != '/') {
+			end++;
+		}
+		const size_t length = end - start;
+		if (length && !(length == 1 && entry.str[start] == '.')) {
+			if (normal.length() > 1) {
+				normal.push_back('/');
+			}
+			normal.append(entry.str + start, length);
+		}
+		start = end + 1;
 	}
+	return true;
+}
 
-	if (full_paths.empty()) {
-		if (error) {
-			*error = errno;
+// Entries of one list, kept as offsets into a string that may grow, so a list
+// is deduplicated in one pass. Short lists need no allocation.
+class entry_set {
+public:
+	explicit entry_set(const size_t count)
+	{
+		size_t capacity = inline_capacity;
+		while (capacity < count * 2) {
+			capacity *= 2;
 		}
-		return full_paths;
+		if (capacity > inline_capacity) {
+			heap_.resize(capacity);
+			slots_ = heap_.data();
+		}
+		for (size_t i = 0; i < capacity; i++) {
+			slots_[i].offset = empty;
+		}
+		mask_ = capacity - 1;
 	}
 
-	if (!multipath) {
-		full_paths.resize(1);
+	// Add the entry at base + offset. Return false if an equal entry was added before.
+	bool insert(const _CXTCHAR* base, const size_t offset, const size_t length)
+	{
+		const _CXTCHAR* str = base + offset;
+		size_t hash = 2166136261u;
+		for (size_t i = 0; i < length; i++) {
+			hash = (hash ^ static_cast<size_t>(str[i])) * 16777619u;
+		}
+		for (size_t i = hash & mask_;; i = (i + 1) & mask_) {
+			slot& entry = slots_[i];
+			if (entry.offset == empty) {
+				entry.offset = offset;
+				entry.length = length;
+				return true;
+			}
+			if (entry.length == length && std::char_traits<_CXTCHAR>::compare(base + entry.offset, str, length) == 0) {
+				return false;
+			}
+		}
 	}
 
-	const _CXTSTR& append_path_str = append_path(appname, nullptr, version);
-	if (!append_path_str.empty()) {
-		for (auto& full_path_i : full_paths) {
-			full_path_i.append(append_path_str);
+private:
+	struct slot {
+		size_t offset;
+		size_t length;
+	};
+	static const size_t inline_capacity = 16;
+	static const size_t empty = static_cast<size_t>(-1);
+	slot inline_[inline_capacity];
+	std::vector<slot> heap_;
+	slot* slots_ = inline_;
+	size_t mask_;
+};
+
+// Return true if paths is used as is, so the common case needs no copy.
+static bool is_normal_site_dir_list(const _CXTCHAR* paths)
+{
+	if (site_dirs_canonical.load(std::memory_order_acquire)) {
+		return false;
+	}
+	entry_set seen(countMultiPath(paths));
+	const _CXTCHAR* cursor = paths;
+	path_view entry;
+	while (nextMultiPath(cursor, entry)) {
+		if (!is_normal_entry(entry) || !seen.insert(paths, static_cast<size_t>(entry.str - paths), entry.length)) {
+			return false;
 		}
 	}
+	return true;
+}
 
-	if (error) {
-		*error = 0;
+// Write paths to storage without relative entries, as the XDG spec requires,
+// and without duplicates. In canonical mode, entries are replaced by their real
+// path, and entries naming the same directory are dropped.
+static const _CXTCHAR* normalize_site_dir_list(const _CXTCHAR* paths, _CXTSTR& storage)
+{
+	const bool canonical = site_dirs_canonical.load(std::memory_order_acquire);
+	storage.clear();
+	std::string normal;
+	std::set<std::pair<dev_t, ino_t>> identities;
+	entry_set seen(countMultiPath(paths));
+	const _CXTCHAR* cursor = paths;
+	path_view entry;
+	while (nextMultiPath(cursor, entry)) {
+		if (!normalize_entry(entry, normal)) {
+			continue;
+		}
+		if (canonical) {
+			const canonical_dir dir = get_canonical_dir(normal);
+			if (dir.found) {
+				if (!identities.insert(std::make_pair(dir.dev, dir.ino)).second) {
+					continue;
+				}
+				normal = dir.path;
+			}
+		}
+		// Append, then take the entry back if it was stored before.
+		const size_t separator_offset = storage.length();
+		if (!storage.empty()) {
+			storage.append(pathsep, 1);
+		}
+		const size_t offset = storage.length();
+		storage.append(normal);
+		if (!seen.insert(storage.data(), offset, normal.length())) {
+			storage.resize(separator_offset);
+		}
+	}
+	return storage.c_str();
+}
+#endif
+
+void appdirs_set_canonical_site_dirs(const bool enable)
+{
+#if !defined(_WIN32) && !defined(__APPLE__)
+	site_dirs_canonical.store(enable, std::memory_order_release);
+#else
+	(void)enable;
+#endif
+}
+
+static std::atomic<bool> layout_cache_enabled(false);
+// Readers load the current snapshot without locking or reference counting.
+// Each thread publishes the snapshot it reads in its own hazard slot, and
+// appdirs_refresh frees a replaced snapshot once no slot holds it, so at most
+// one replaced snapshot per reading thread is kept.
+static std::atomic<const layout_snapshot*> layout_cache(nullptr);
+static std::mutex layout_cache_mutex;
+
+// Hazard slot of one thread, reused by a later thread once its owner exits.
+struct layout_reader {
+	std::atomic<const layout_snapshot*> snapshot;
+	std::atomic<bool> in_use;
+	// Nested resolvers on the same thread share the outer snapshot.
+	unsigned depth = 0;
+	layout_reader* next = nullptr;
+	// Keep slots of different threads on different cache lines.
+	char padding[64];
+};
+// Never freed, as a thread may exit after main returns.
+struct layout_readers {
+	std::mutex mutex;
+	layout_reader* head = nullptr;
+	// Replaced snapshots still held by a reader. Requires layout_cache_mutex.
+	std::vector<const layout_snapshot*> retired;
+};
+static layout_readers& get_layout_readers()
+{
+	static layout_readers* const readers = new layout_readers();
+	return *readers;
+}
+
+struct layout_reader_owner {
+	layout_reader* reader;
+
+	layout_reader_owner()
+	{
+		layout_readers& readers = get_layout_readers();
+		std::lock_guard<std::mutex> lock(readers.mutex);
+		for (reader = readers.head; reader; reader = reader->next) {
+			if (!reader->in_use.load(std::memory_order_relaxed)) {
+				reader->in_use.store(true, std::memory_order_relaxed);
+				return;
+			}
+		}
+		reader = new layout_reader();
+		reader->snapshot.store(nullptr, std::memory_order_relaxed);
+		reader->in_use.store(true, std::memory_order_relaxed);
+		reader->next = readers.head;
+		readers.head = reader;
+	}
+	~layout_reader_owner()
+	{
+		layout_readers& readers = get_layout_readers();
+		std::lock_guard<std::mutex> lock(readers.mutex);
+		reader->snapshot.store(nullptr, std::memory_order_release);
+		reader->depth = 0;
+		reader->in_use.store(false, std::memory_order_relaxed);
+	}
+};
+
+static const _CXTCHAR* lookup_site_dir_list(const bool config, _CXTSTR& storage, env_context& env);
+
+static const layout_snapshot* make_layout_snapshot()
+{
+	APPDIRS_STAT_TIMER(layout_snapshot_ns);
+	std::unique_ptr<layout_snapshot> snapshot(new layout_snapshot());
+	env_context env;
+	for (int id = 0; id < base_dir_count; id++) {
+		base_dir base;
+		lookup_base_dir(static_cast<base_dir_id>(id), base, env);
+		if (base.head) {
+			snapshot->base_dirs[id] = _CXTSTR(base.head) + base.tail;
+		}
+	}
+	for (int config = 0; config < 2; config++) {
+		_CXTSTR storage;
+		const _CXTCHAR* paths = lookup_site_dir_list(config != 0, storage, env);
+		snapshot->site_dir_found[config] = paths != nullptr;
+		if (paths) {
+			snapshot->site_dir_lists[config] = paths;
+		}
+	}
+	return snapshot.release();
+}
+
+// Return the current snapshot, or NULL if cached mode is disabled. The
+// snapshot is not freed until release_layout_snapshot is called with reader.
+static const layout_snapshot* acquire_layout_snapshot(layout_reader*& reader)
+{
+	if (!layout_cache_enabled.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+	static thread_local layout_reader_owner owner;
+	reader = owner.reader;
+	if (reader->depth++) {
+		return reader->snapshot.load(std::memory_order_relaxed);
+	}
+
+	const layout_snapshot* snapshot = layout_cache.load(std::memory_order_acquire);
+	if (!snapshot) {
+		std::lock_guard<std::mutex> lock(layout_cache_mutex);
+		snapshot = layout_cache.load(std::memory_order_acquire);
+		if (!snapshot) {
+			snapshot = make_layout_snapshot();
+			layout_cache.store(snapshot, std::memory_order_seq_cst);
+		}
+	}
+	// Publish the hazard, then check the snapshot was not replaced meanwhile,
+	// as appdirs_refresh replaces it before scanning the slots.
+	while (true) {
+		reader->snapshot.store(snapshot, std::memory_order_seq_cst);
+		const layout_snapshot* current = layout_cache.load(std::memory_order_seq_cst);
+		if (current == snapshot) {
+			return snapshot;
+		}
+		snapshot = current;
+	}
+}
+
+static void release_layout_snapshot(layout_reader* reader)
+{
+	if (reader && !--reader->depth) {
+		reader->snapshot.store(nullptr, std::memory_order_release);
+	}
+}
+
+static void get_base_dir(base_dir_id id, base_dir& base, env_context& env)
+{
+	const layout_snapshot* snapshot = env.is_process() ? env.layout() : nullptr;
+	if (!snapshot) {
+		lookup_base_dir(id, base, env);
+		return;
+	}
+
+	// Do not cache a failed lookup, let errno describe the fault instead.
+	if (snapshot->base_dirs[id].empty()) {
+		lookup_base_dir(id, base, env);
+		return;
+	}
+	base.head = snapshot->base_dirs[id].c_str();
+}
+
+void appdirs_set_cached(const bool enable)
+{
+	layout_cache_enabled.store(enable, std::memory_order_release);
+}
+
+void appdirs_refresh()
+{
+#if !defined(_WIN32) && !defined(__APPLE__)
+	{
+		std::lock_guard<std::mutex> lock(canonical_dirs_mutex);
+		canonical_dirs.clear();
+	}
+#endif
+	std::lock_guard<std::mutex> lock(layout_cache_mutex);
+	const layout_snapshot* replaced = layout_cache.load(std::memory_order_relaxed);
+	layout_cache.store(make_layout_snapshot(), std::memory_order_seq_cst);
+	layout_readers& readers = get_layout_readers();
+	if (replaced) {
+		readers.retired.push_back(replaced);
+	}
+
+	// Free every replaced snapshot no reader holds.
+	std::lock_guard<std::mutex> readers_lock(readers.mutex);
+	auto kept = readers.retired.begin();
+	for (const layout_snapshot* retired : readers.retired) {
+		bool held = false;
+		for (const layout_reader* reader = readers.head; reader && !held; reader = reader->next) {
+			held = reader->snapshot.load(std::memory_order_seq_cst) == retired;
+		}
+		if (held) {
+			*kept++ = retired;
+		}
+		else {
+			delete retired;
+		}
+	}
+	readers.retired.erase(kept, readers.retired.end());
+}
+
+static inline void append_user_path(
+    path_pieces& pieces,
+    const base_dir& base,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool cache_opinion,
+    const bool log_opinion)
+{
+	pieces.add(base.head);
+	pieces.add(base.tail);
+	append_path(pieces, appname, appauthor, version, cache_opinion);
+	if (log_opinion) {
+		pieces.add(slash_cat log_str);
+	}
+}
+
+static size_t write_user_dir(
+    path_output& output,
+    env_context& env,
+    const base_dir_id id,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool cache_opinion,
+    const bool log_opinion,
+    int* error)
+{
+	base_dir base;
+	get_base_dir(id, base, env);
+
+	if (!base.head) {
+		if (error) {
+			*error = errno;
+		}
+		return 0;
+	}
+
+	path_pieces pieces;
+	append_user_path(pieces, base, appname, appauthor, version, cache_opinion, log_opinion);
+	output.append(pieces);
+
+	if (error) {
+		*error = 0;
+	}
+	return output.length();
+}
+
+static size_t write_user_dir(
+    path_output& output,
+    const base_dir_id id,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool cache_opinion,
+    const bool log_opinion,
+    int* error)
+{
+	env_context env;
+	return write_user_dir(output, env, id, appname, appauthor, version, cache_opinion, log_opinion, error);
+}
+
+// Return site directories as a single list joined by path separator.
+static const _CXTCHAR* lookup_site_dir_list(const bool config, _CXTSTR& storage, env_context& env)
+{
+#if defined(_WIN32)
+	wins_getFolderPath(CSIDL_COMMON_APPDATA, FOLDERID_ProgramData, storage);
+	return storage.empty() ? nullptr : storage.c_str();
+#elif defined(__APPLE__)
+	return config ? "/Library/Preferences" : "/Library/Application Support";
+#else
+	const char* defaults = config ? "/etc/xdg" : "/usr/local/share" pathsep "/usr/share";
+	const char* paths = env.get(config ? "XDG_CONFIG_DIRS" : "XDG_DATA_DIRS");
+	if (paths && !is_normal_site_dir_list(paths)) {
+		paths = normalize_site_dir_list(paths, storage);
+	}
+	// Unset, empty, or only relative entries, fall back to the default.
+	if (!paths || !*paths) {
+		paths = is_normal_site_dir_list(defaults) ? defaults : normalize_site_dir_list(defaults, storage);
+	}
+	return paths;
+#endif
+}
+
+static const _CXTCHAR* get_site_dir_list(const bool config, _CXTSTR& storage, env_context& env)
+{
+	const layout_snapshot* snapshot = env.is_process() ? env.layout() : nullptr;
+	if (!snapshot || !snapshot->site_dir_found[config]) {
+		return lookup_site_dir_list(config, storage, env);
+	}
+	return snapshot->site_dir_lists[config].c_str();
+}
+
+static inline void append_site_path(
+    path_pieces& pieces,
+    const bool config,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version)
+{
+#if defined(__APPLE__)
+	// site_config_dir only appends appname on macOS.
+	append_path(pieces, appname, appauthor, config ? AppDirsStr() : version);
+#else
+	append_path(pieces, appname, appauthor, version);
+#endif
+}
+
+static void write_site_list(
+    path_output& output,
+    const _CXTCHAR* paths,
+    const path_pieces& suffix,
+    const bool multipath)
+{
+	const _CXTCHAR* cursor = paths;
+	path_view entry;
+	while (nextMultiPath(cursor, entry)) {
+		if (entry.str != paths) {
+			output.append(pathsep, 1);
+		}
+		output.append(entry.str, entry.length);
+		output.append(suffix);
+		if (!multipath) {
+			break;
+		}
+	}
+}
+
+static size_t write_site_dir(
+    path_output& output,
+    const bool config,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    int* error)
+{
+	env_context env;
+	_CXTSTR storage;
+	const _CXTCHAR* paths = get_site_dir_list(config, storage, env);
+	if (!paths) {
+		if (error) {
+			*error = errno;
+		}
+		return 0;
+	}
+
+	path_pieces suffix;
+	append_site_path(suffix, config, appname, appauthor, version);
+	write_site_list(output, paths, suffix, multipath);
+
+	if (error) {
+		*error = 0;
+	}
+	return output.length();
+}
+
+static std::vector<_CXTSTR> get_site_dirs(
+    env_context& env,
+    const bool config,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    int* error)
+{
+	std::vector<_CXTSTR> full_paths;
+	_CXTSTR storage;
+	const _CXTCHAR* paths = get_site_dir_list(config, storage, env);
+	if (!paths) {
+		if (error) {
+			*error = errno;
+		}
+		return full_paths;
+	}
+
+	std::vector<path_view> entries;
+	if (multipath) {
+		splitMultiPath(paths, entries);
+	}
+	else {
+		const _CXTCHAR* cursor = paths;
+		entries.resize(1);
+		nextMultiPath(cursor, entries[0]);
+	}
+
+	path_pieces suffix;
+	append_site_path(suffix, config, appname, appauthor, version);
+
+	full_paths.resize(entries.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		full_paths[i].reserve(entries[i].length + suffix.length);
+		path_output output(full_paths[i]);
+		output.append(entries[i].str, entries[i].length);
+		output.append(suffix);
+	}
+
+	if (error) {
+		*error = 0;
 	}
 	return full_paths;
+}
+
+static std::vector<_CXTSTR> get_site_dirs(
+    const bool config,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    int* error)
+{
+	env_context env;
+	return get_site_dirs(env, config, appname, appauthor, version, multipath, error);
+}
+
+struct appdirs_detail::path_list_access {
+	static _CXTSTR& buffer(PathList& list)
+	{
+		return list.buffer_;
+	}
+	static std::vector<size_t>& offsets(PathList& list)
+	{
+		return list.offsets_;
+	}
+};
+
+static size_t get_site_path_list(
+    const bool config,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    PathList& list,
+    int* error)
+{
+	using appdirs_detail::path_list_access;
+	_CXTSTR& buffer = path_list_access::buffer(list);
+	std::vector<size_t>& offsets = path_list_access::offsets(list);
+	list.clear();
+
+	env_context env;
+	_CXTSTR storage;
+	const _CXTCHAR* paths = get_site_dir_list(config, storage, env);
+	if (!paths) {
+		if (error) {
+			*error = errno;
+		}
+		return 0;
+	}
+
+	path_pieces suffix;
+	append_site_path(suffix, config, appname, appauthor, version);
+
+	// Count first, so the buffer and offsets are each sized once.
+	size_t count = 0;
+	size_t total = 0;
+	const _CXTCHAR* cursor = paths;
+	path_view entry;
+	while (nextMultiPath(cursor, entry)) {
+		count++;
+		total += entry.length + suffix.length + 1;
+		if (!multipath) {
+			break;
+		}
+	}
+	if (buffer.capacity() < total || offsets.capacity() < count + 1) {
+		APPDIRS_STAT_COUNT(allocations);
+	}
+	buffer.reserve(total);
+	offsets.reserve(count + 1);
+
+	path_output output(buffer);
+	cursor = paths;
+	while (nextMultiPath(cursor, entry)) {
+		offsets.push_back(buffer.length());
+		output.append(entry.str, entry.length);
+		output.append(suffix);
+		buffer.push_back(0);
+		if (!multipath) {
+			break;
+		}
+	}
+	offsets.push_back(buffer.length());
+
+	if (error) {
+		*error = 0;
+	}
+	return count;
+}
+
+static inline base_dir_id user_config_base(const bool roaming)
+{
+#if defined(_WIN32) // same as user_data_dir
+	return roaming ? base_user_data_roaming : base_user_data_local;
+#else
+	return base_user_config;
+#endif
+}
+
+static inline base_dir_id user_state_base(const bool roaming)
+{
+#if defined(_WIN32) // same as user_data_dir
+	return roaming ? base_user_data_roaming : base_user_data_local;
+#elif defined(__APPLE__)
+	return base_user_data_local;
+#else
+	return base_user_state;
+#endif
+}
+
+static inline base_dir_id user_log_base()
+{
+#if defined(_WIN32) // under user_data_dir
+	return base_user_data_local;
+#elif defined(__APPLE__)
+	return base_user_log;
+#else // under user_cache_dir
+	return base_user_cache;
+#endif
+}
+
+static inline bool user_log_opinion(const bool opinion)
+{
+#if defined(__APPLE__)
+	return false;
+#else
+	return opinion;
+#endif
+}
+
+_CXTSTR user_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	return user_data_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), roaming, error);
+}
+
+size_t user_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error)
+{
+	return user_data_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), roaming, full_path, error);
+}
+
+size_t user_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	return user_data_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), roaming, buffer, buffer_size, error);
+}
+
+std::vector<_CXTSTR> site_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    int* error)
+{
+	return site_data_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), multipath, error);
+}
+
+size_t site_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    _CXTSTR& full_paths,
+    int* error)
+{
+	return site_data_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), multipath, full_paths, error);
+}
+
+size_t site_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	return site_data_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), multipath, buffer, buffer_size, error);
+}
+
+size_t site_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    PathList& paths,
+    int* error)
+{
+	return site_data_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), multipath, paths, error);
+}
+
+_CXTSTR user_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	return user_config_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), roaming, error);
+}
+
+size_t user_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error)
+{
+	return user_config_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), roaming, full_path, error);
+}
+
+size_t user_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	return user_config_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), roaming, buffer, buffer_size, error);
+}
+
+std::vector<_CXTSTR> site_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    int* error)
+{
+	return site_config_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), multipath, error);
+}
+
+size_t site_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    _CXTSTR& full_paths,
+    int* error)
+{
+	return site_config_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), multipath, full_paths, error);
+}
+
+size_t site_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	return site_config_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), multipath, buffer, buffer_size, error);
+}
+
+size_t site_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    PathList& paths,
+    int* error)
+{
+	return site_config_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), multipath, paths, error);
+}
+
+_CXTSTR user_cache_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    int* error)
+{
+	return user_cache_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), opinion, error);
+}
+
+size_t user_cache_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    _CXTSTR& full_path,
+    int* error)
+{
+	return user_cache_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), opinion, full_path, error);
+}
+
+size_t user_cache_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	return user_cache_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), opinion, buffer, buffer_size, error);
+}
+
+_CXTSTR user_state_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	return user_state_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), roaming, error);
+}
+
+size_t user_state_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error)
+{
+	return user_state_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), roaming, full_path, error);
+}
+
+size_t user_state_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	return user_state_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), roaming, buffer, buffer_size, error);
+}
+
+_CXTSTR user_log_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    int* error)
+{
+	return user_log_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), opinion, error);
+}
+
+size_t user_log_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    _CXTSTR& full_path,
+    int* error)
+{
+	return user_log_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), opinion, full_path, error);
+}
+
+size_t user_log_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	return user_log_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), opinion, buffer, buffer_size, error);
+}
+
+_CXTSTR user_runtime_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    int* error)
+{
+	return user_runtime_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), error);
+}
+
+size_t user_runtime_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    _CXTSTR& full_path,
+    int* error)
+{
+	return user_runtime_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), full_path, error);
+}
+
+size_t user_runtime_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	return user_runtime_dir(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), buffer, buffer_size, error);
+}
+
+_CXTSTR user_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_data_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	write_user_dir(output, roaming ? base_user_data_roaming : base_user_data_local, appname, appauthor, version, false, false, error);
+	return full_path;
+}
+
+size_t user_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_data_dir_calls);
+	path_output output(full_path);
+	return write_user_dir(output, roaming ? base_user_data_roaming : base_user_data_local, appname, appauthor, version, false, false, error);
+}
+
+size_t user_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_data_dir_calls);
+	path_output output(buffer, buffer_size);
+	return write_user_dir(output, roaming ? base_user_data_roaming : base_user_data_local, appname, appauthor, version, false, false, error);
+}
+
+std::vector<_CXTSTR> site_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(site_data_dir_calls);
+	return get_site_dirs(false, appname, appauthor, version, multipath, error);
+}
+
+size_t site_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    _CXTSTR& full_paths,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(site_data_dir_calls);
+	path_output output(full_paths);
+	return write_site_dir(output, false, appname, appauthor, version, multipath, error);
+}
+
+size_t site_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(site_data_dir_calls);
+	path_output output(buffer, buffer_size);
+	return write_site_dir(output, false, appname, appauthor, version, multipath, error);
+}
+
+size_t site_data_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    PathList& paths,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(site_data_dir_calls);
+	return get_site_path_list(false, appname, appauthor, version, multipath, paths, error);
+}
+
+_CXTSTR user_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_config_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	write_user_dir(output, user_config_base(roaming), appname, appauthor, version, false, false, error);
+	return full_path;
+}
+
+size_t user_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_config_dir_calls);
+	path_output output(full_path);
+	return write_user_dir(output, user_config_base(roaming), appname, appauthor, version, false, false, error);
+}
+
+size_t user_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_config_dir_calls);
+	path_output output(buffer, buffer_size);
+	return write_user_dir(output, user_config_base(roaming), appname, appauthor, version, false, false, error);
+}
+
+std::vector<_CXTSTR> site_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(site_config_dir_calls);
+	return get_site_dirs(true, appname, appauthor, version, multipath, error);
+}
+
+size_t site_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    _CXTSTR& full_paths,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(site_config_dir_calls);
+	path_output output(full_paths);
+	return write_site_dir(output, true, appname, appauthor, version, multipath, error);
+}
+
+size_t site_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(site_config_dir_calls);
+	path_output output(buffer, buffer_size);
+	return write_site_dir(output, true, appname, appauthor, version, multipath, error);
+}
+
+size_t site_config_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool multipath,
+    PathList& paths,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(site_config_dir_calls);
+	return get_site_path_list(true, appname, appauthor, version, multipath, paths, error);
+}
+
+_CXTSTR user_cache_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool opinion,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_cache_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	write_user_dir(output, base_user_cache, appname, appauthor, version, opinion, false, error);
+	return full_path;
+}
+
+size_t user_cache_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool opinion,
+    _CXTSTR& full_path,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_cache_dir_calls);
+	path_output output(full_path);
+	return write_user_dir(output, base_user_cache, appname, appauthor, version, opinion, false, error);
+}
+
+size_t user_cache_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool opinion,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_cache_dir_calls);
+	path_output output(buffer, buffer_size);
+	return write_user_dir(output, base_user_cache, appname, appauthor, version, opinion, false, error);
+}
+
+_CXTSTR user_state_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_state_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	write_user_dir(output, user_state_base(roaming), appname, appauthor, version, false, false, error);
+	return full_path;
+}
+
+size_t user_state_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTSTR& full_path,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_state_dir_calls);
+	path_output output(full_path);
+	return write_user_dir(output, user_state_base(roaming), appname, appauthor, version, false, false, error);
+}
+
+size_t user_state_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool roaming,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_state_dir_calls);
+	path_output output(buffer, buffer_size);
+	return write_user_dir(output, user_state_base(roaming), appname, appauthor, version, false, false, error);
+}
+
+_CXTSTR user_log_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool opinion,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_log_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	write_user_dir(output, user_log_base(), appname, appauthor, version, false, user_log_opinion(opinion), error);
+	return full_path;
+}
+
+size_t user_log_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool opinion,
+    _CXTSTR& full_path,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_log_dir_calls);
+	path_output output(full_path);
+	return write_user_dir(output, user_log_base(), appname, appauthor, version, false, user_log_opinion(opinion), error);
+}
+
+size_t user_log_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const bool opinion,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_log_dir_calls);
+	path_output output(buffer, buffer_size);
+	return write_user_dir(output, user_log_base(), appname, appauthor, version, false, user_log_opinion(opinion), error);
+}
+
+_CXTSTR user_runtime_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_runtime_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	write_user_dir(output, base_user_runtime, appname, appauthor, version, false, false, error);
+	return full_path;
+}
+
+size_t user_runtime_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    _CXTSTR& full_path,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_runtime_dir_calls);
+	path_output output(full_path);
+	return write_user_dir(output, base_user_runtime, appname, appauthor, version, false, false, error);
+}
+
+size_t user_runtime_dir(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_runtime_dir_calls);
+	path_output output(buffer, buffer_size);
+	return write_user_dir(output, base_user_runtime, appname, appauthor, version, false, false, error);
+}
+
+// Fills the private storage of AppDirs.
+struct appdirs_detail::app_dirs_access {
+	static _CXTSTR& buffer(AppDirs& dirs)
+	{
+		return dirs.buffer_;
+	}
+	static size_t& offset(AppDirs& dirs, const AppDirs::dir id)
+	{
+		return dirs.offsets_[id];
+	}
+	static size_t& length(AppDirs& dirs, const AppDirs::dir id)
+	{
+		return dirs.lengths_[id];
+	}
+};
+
+static AppDirs resolve_all(
+    env_context& env,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const AppDirsOptions& options,
+    int* error)
+{
+	using appdirs_detail::app_dirs_access;
+	AppDirs dirs;
+	int error_local = 0;
+
+	// Look up every base directory once, shared by both passes below.
+	const base_dir_id user_ids[] = {
+		options.roaming ? base_user_data_roaming : base_user_data_local,
+		user_config_base(options.roaming),
+		base_user_cache,
+		user_state_base(options.roaming),
+		user_log_base(),
+	};
+	const AppDirs::dir user_dirs[] = { AppDirs::user_data, AppDirs::user_config, AppDirs::user_cache, AppDirs::user_state, AppDirs::user_log };
+	base_dir bases[5];
+	for (int i = 0; i < 5; i++) {
+		get_base_dir(user_ids[i], bases[i], env);
+		if (!bases[i].head && !error_local) {
+			error_local = errno;
+		}
+	}
+
+	_CXTSTR site_storage[2];
+	const _CXTCHAR* site_lists[2];
+	path_pieces site_suffix[2];
+	for (int config = 0; config < 2; config++) {
+		site_lists[config] = get_site_dir_list(config != 0, site_storage[config], env);
+		if (!site_lists[config] && !error_local) {
+			error_local = errno;
+		}
+		append_site_path(site_suffix[config], config != 0, appname, appauthor, version);
+	}
+
+	path_pieces user_pieces[5];
+	for (int i = 0; i < 5; i++) {
+		if (bases[i].head) {
+			const bool cache_opinion = user_dirs[i] == AppDirs::user_cache && options.opinion;
+			const bool log_opinion = user_dirs[i] == AppDirs::user_log && user_log_opinion(options.opinion);
+			append_user_path(user_pieces[i], bases[i], appname, appauthor, version, cache_opinion, log_opinion);
+		}
+	}
+
+	// First pass only counts the length, so the buffer is allocated once.
+	const auto write_all = [&](path_output& output) {
+		for (int i = 0; i < 5; i++) {
+			app_dirs_access::offset(dirs, user_dirs[i]) = output.length();
+			output.append(user_pieces[i]);
+			app_dirs_access::length(dirs, user_dirs[i]) = output.length() - app_dirs_access::offset(dirs, user_dirs[i]);
+			output.append(_CXT(""), 1);
+		}
+		for (int config = 0; config < 2; config++) {
+			const AppDirs::dir id = config ? AppDirs::site_config : AppDirs::site_data;
+			app_dirs_access::offset(dirs, id) = output.length();
+			if (site_lists[config]) {
+				write_site_list(output, site_lists[config], site_suffix[config], options.multipath);
+			}
+			app_dirs_access::length(dirs, id) = output.length() - app_dirs_access::offset(dirs, id);
+			output.append(_CXT(""), 1);
+		}
+	};
+	path_output counter(nullptr, 0);
+	write_all(counter);
+	app_dirs_access::buffer(dirs).reserve(counter.length());
+	path_output output(app_dirs_access::buffer(dirs));
+	write_all(output);
+
+	if (error) {
+		*error = error_local;
+	}
+	return dirs;
+}
+
+AppDirs resolve_all(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const AppDirsOptions& options,
+    int* error)
+{
+	return resolve_all(AppDirsStr(appname), AppDirsStr(appauthor), AppDirsStr(version), options, error);
+}
+
+AppDirs resolve_all(
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    const AppDirsOptions& options,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(resolve_all_calls);
+	env_context env;
+	return resolve_all(env, appname, appauthor, version, options, error);
+}
+
+static size_t write_dir_with_suffix(
+    path_output& output,
+    const AppDirs::dir id,
+    const bool option,
+    const _CXTCHAR* suffix,
+    const size_t suffix_length,
+    int* error)
+{
+	env_context env;
+	path_pieces suffix_pieces;
+	suffix_pieces.add(suffix, suffix_length);
+
+	if (id == AppDirs::site_data || id == AppDirs::site_config) {
+		_CXTSTR storage;
+		const _CXTCHAR* paths = get_site_dir_list(id == AppDirs::site_config, storage, env);
+		if (!paths) {
+			if (error) {
+				*error = errno;
+			}
+			return 0;
+		}
+		write_site_list(output, paths, suffix_pieces, option);
+	}
+	else {
+		base_dir_id base_id;
+		switch (id) {
+			case AppDirs::user_config:
+				base_id = user_config_base(option);
+				break;
+			case AppDirs::user_cache:
+				base_id = base_user_cache;
+				break;
+			case AppDirs::user_state:
+				base_id = user_state_base(option);
+				break;
+			case AppDirs::user_log:
+				base_id = user_log_base();
+				break;
+			default:
+				base_id = option ? base_user_data_roaming : base_user_data_local;
+				break;
+		}
+		base_dir base;
+		get_base_dir(base_id, base, env);
+		if (!base.head) {
+			if (error) {
+				*error = errno;
+			}
+			return 0;
+		}
+
+		path_pieces pieces;
+		pieces.add(base.head);
+		pieces.add(base.tail);
+		pieces.add(suffix, suffix_length);
+		if (id == AppDirs::user_log && user_log_opinion(option)) {
+			pieces.add(slash_cat log_str);
+		}
+		output.append(pieces);
+	}
+
+	if (error) {
+		*error = 0;
+	}
+	return output.length();
+}
+
+size_t resolve_dir(
+    const AppDirs::dir id,
+    const bool option,
+    const _CXTCHAR* suffix,
+    const size_t suffix_length,
+    _CXTSTR& full_path,
+    int* error)
+{
+	path_output output(full_path);
+	return write_dir_with_suffix(output, id, option, suffix, suffix_length, error);
+}
+
+size_t resolve_dir(
+    const AppDirs::dir id,
+    const bool option,
+    const _CXTCHAR* suffix,
+    const size_t suffix_length,
+    _CXTCHAR* buffer,
+    const size_t buffer_size,
+    int* error)
+{
+	path_output output(buffer, buffer_size);
+	return write_dir_with_suffix(output, id, option, suffix, suffix_length, error);
+}
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <climits>
+
+// Return true if candidate exists and is not a directory after following symlinks,
+// opening it when fd is requested. A directory of the same name does not hide later files.
+static bool probe_file(const char* candidate, int* fd)
+{
+	struct stat st;
+	if (fd) {
+		*fd = openat(AT_FDCWD, candidate, O_RDONLY | O_CLOEXEC);
+		if (*fd < 0) {
+			return false;
+		}
+		if (!fstat(*fd, &st) && !S_ISDIR(st.st_mode)) {
+			return true;
+		}
+		close(*fd);
+		*fd = -1;
+		errno = EISDIR;
+		return false;
+	}
+	if (fstatat(AT_FDCWD, candidate, &st, 0)) {
+		return false;
+	}
+	if (S_ISDIR(st.st_mode)) {
+		errno = EISDIR;
+		return false;
+	}
+	return true;
+}
+
+static _CXTSTR find_file(
+    const bool config,
+    const _CXTSTR& relpath,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    int* fd,
+    int* error)
+{
+	if (fd) {
+		*fd = -1;
+	}
+	if (relpath.empty()) {
+		if (error) {
+			*error = EINVAL;
+		}
+		return _CXTSTR();
+	}
+
+	env_context env;
+	char candidate[PATH_MAX];
+	int error_local = ENOENT;
+
+	path_pieces relpath_pieces;
+	relpath_pieces.add(slash_cat);
+	relpath_pieces.add(relpath);
+
+	// User directory has precedence over site directories.
+	base_dir base;
+	get_base_dir(config ? user_config_base(false) : base_user_data_local, base, env);
+	if (base.head) {
+		path_pieces pieces;
+		append_user_path(pieces, base, appname, appauthor, version, false, false);
+		path_output output(candidate, sizeof(candidate));
+		output.append(pieces);
+		output.append(relpath_pieces);
+		if (output.length() >= sizeof(candidate)) {
+			error_local = ENAMETOOLONG;
+		}
+		else if (probe_file(candidate, fd)) {
+			if (error) {
+				*error = 0;
+			}
+			return _CXTSTR(candidate, output.length());
+		}
+	}
+
+	_CXTSTR storage;
+	const char* paths = get_site_dir_list(config, storage, env);
+	path_pieces suffix;
+	append_site_path(suffix, config, appname, appauthor, version);
+	const char* cursor = paths;
+	path_view entry;
+	while (nextMultiPath(cursor, entry)) {
+		path_output output(candidate, sizeof(candidate));
+		output.append(entry.str, entry.length);
+		output.append(suffix);
+		output.append(relpath_pieces);
+		if (output.length() >= sizeof(candidate)) {
+			error_local = ENAMETOOLONG;
+		}
+		else if (probe_file(candidate, fd)) {
+			if (error) {
+				*error = 0;
+			}
+			return _CXTSTR(candidate, output.length());
+		}
+	}
+
+	if (error) {
+		*error = error_local;
+	}
+	return _CXTSTR();
+}
+
+_CXTSTR find_data_file(
+    const _CXTSTR& relpath,
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    int* fd,
+    int* error)
+{
+	return find_file(false, relpath, appname, appauthor, version, fd, error);
+}
+
+_CXTSTR find_config_file(
+    const _CXTSTR& relpath,
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    int* fd,
+    int* error)
+{
+	return find_file(true, relpath, appname, appauthor, version, fd, error);
+}
+#endif
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#include <unordered_set>
+
+// Directories created or found by ensure_* functions in this process, checked again on each call.
+static std::mutex ensured_dirs_mutex;
+static std::unordered_set<std::string> ensured_dirs;
+
+// Create path and any missing parents, path is modified in the process.
+static int make_dir(std::string path)
+{
+	while (path.length() > 1 && path.back() == '/') {
+		path.pop_back();
+	}
+
+	// Try the leaf first, in most cases its parents already exist.
+	if (mkdir(path.c_str(), 0700) == 0) {
+		return 0;
+	}
+	if (errno == EEXIST) {
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0) {
+			return errno;
+		}
+		return S_ISDIR(st.st_mode) ? 0 : ENOTDIR;
+	}
+	if (errno != ENOENT) {
+		return errno;
+	}
+
+	// Walk back until an ancestor exists or is created.
+	std::vector<size_t> missing;
+	size_t end = path.length();
+	while (true) {
+		missing.push_back(end);
+		end = path.rfind('/', end - 1);
+		while (end != std::string::npos && end > 0 && path[end - 1] == '/') {
+			end--;
+		}
+		if (end == std::string::npos || end == 0) {
+			return ENOENT;
+		}
+		path[end] = 0;
+		if (mkdir(path.c_str(), 0700) == 0 || errno == EEXIST) {
+			break;
+		}
+		if (errno != ENOENT) {
+			return errno;
+		}
+		path[end] = '/';
+	}
+
+	// Then create each missing directory relative to its parent.
+	int parent_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (parent_fd < 0) {
+		return errno;
+	}
+	int result = 0;
+	for (size_t i = missing.size(); i-- > 0;) {
+		size_t name_begin = end + 1;
+		while (path[name_begin] == '/') {
+			name_begin++;
+		}
+		const char* name = &path[name_begin];
+		end = missing[i];
+		if (end < path.length()) {
+			path[end] = 0;
+		}
+		if (mkdirat(parent_fd, name, 0700) != 0 && errno != EEXIST) {
+			result = errno;
+			break;
+		}
+		if (i == 0) {
+			break;
+		}
+		const int child_fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (child_fd < 0) {
+			result = errno;
+			break;
+		}
+		close(parent_fd);
+		parent_fd = child_fd;
+	}
+	close(parent_fd);
+	return result;
+}
+
+static _CXTSTR ensure_dir(_CXTSTR full_path, int* error)
+{
+	if (full_path.empty()) {
+		return full_path;
+	}
+
+	// A remembered directory only costs a stat, to recreate it if it was removed since.
+	bool ensured;
+	{
+		std::lock_guard<std::mutex> lock(ensured_dirs_mutex);
+		ensured = ensured_dirs.count(full_path) != 0;
+	}
+	if (ensured) {
+		struct stat st;
+		if (stat(full_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+			return full_path;
+		}
+		std::lock_guard<std::mutex> lock(ensured_dirs_mutex);
+		ensured_dirs.erase(full_path);
+	}
+
+	const int result = make_dir(full_path);
+	if (result) {
+		if (error) {
+			*error = result;
+		}
+		return _CXTSTR();
+	}
+
+	std::lock_guard<std::mutex> lock(ensured_dirs_mutex);
+	ensured_dirs.insert(full_path);
+	return full_path;
+}
+
+_CXTSTR ensure_user_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	return ensure_dir(user_data_dir(appname, appauthor, version, roaming, error), error);
+}
+
+_CXTSTR ensure_user_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	return ensure_dir(user_config_dir(appname, appauthor, version, roaming, error), error);
+}
+
+_CXTSTR ensure_user_cache_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    int* error)
+{
+	return ensure_dir(user_cache_dir(appname, appauthor, version, opinion, error), error);
+}
+
+_CXTSTR ensure_user_state_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	return ensure_dir(user_state_dir(appname, appauthor, version, roaming, error), error);
+}
+
+_CXTSTR ensure_user_log_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    int* error)
+{
+	return ensure_dir(user_log_dir(appname, appauthor, version, opinion, error), error);
+}
+
+_CXTSTR ensure_user_runtime_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    int* error)
+{
+	_CXTSTR full_path = user_runtime_dir(appname, appauthor, version, error);
+#if !defined(__APPLE__)
+	// The per-uid fallback is created and checked before anything inside it.
+	const int result = full_path.empty() ? 0 : make_runtime_dir(full_path);
+	if (result) {
+		if (error) {
+			*error = result;
+		}
+		return _CXTSTR();
+	}
+#endif
+	return ensure_dir(std::move(full_path), error);
+}
+#endif
+
+#if !defined(_WIN32)
+#include <cstring>
+
+#if defined(O_PATH)
+#define APPDIRS_O_DIR_HANDLE (O_PATH | O_DIRECTORY | O_CLOEXEC)
+#else
+#define APPDIRS_O_DIR_HANDLE (O_RDONLY | O_DIRECTORY | O_CLOEXEC)
+#endif
+
+// Directory handles opened by this process, one per path, kept open until exit.
+struct dir_handle {
+	int fd;
+	dev_t dev;
+	ino_t ino;
+};
+static std::mutex dir_handles_mutex;
+static std::unordered_map<std::string, dir_handle> dir_handles;
+
+// Make fd refer to the directory opened as replacement, then close replacement.
+// Callers may still use fd, so it is never closed, only moved to the new directory.
+static int replace_dir_handle(const int fd, const int replacement)
+{
+#if defined(__linux__)
+	const int result = dup3(replacement, fd, O_CLOEXEC);
+#else
+	const int result = dup2(replacement, fd) < 0 ? -1 : fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+	const int error_local = errno;
+	close(replacement);
+	errno = error_local;
+	return result < 0 ? -1 : fd;
+}
+
+// Return the cached handle of path, else open and cache it. Returns -1 with errno set on failure.
+// A cached handle is only returned while path still names the same directory as the handle.
+// A hit costs two stat calls: fstatat of path, and fstat of the handle.
+static int open_dir_handle(const char* path, const size_t length)
+{
+	struct stat path_st;
+	if (fstatat(AT_FDCWD, path, &path_st, 0)) {
+		return -1;
+	}
+	// Reused, so a hit does not allocate.
+	thread_local std::string key;
+	key.assign(path, length);
+
+	std::lock_guard<std::mutex> lock(dir_handles_mutex);
+	const auto found = dir_handles.find(key);
+	int fd;
+	if (found != dir_handles.end()) {
+		const dir_handle& handle = found->second;
+		struct stat fd_st;
+		const bool fd_valid = !fstat(handle.fd, &fd_st) && fd_st.st_dev == handle.dev && fd_st.st_ino == handle.ino;
+		if (fd_valid && path_st.st_dev == handle.dev && path_st.st_ino == handle.ino) {
+			return handle.fd;
+		}
+		// The directory was removed and recreated, or replaced: the same handle now refers to the new one.
+		// A closed handle may now be an unrelated file of the caller, only reuse ours.
+		fd = openat(AT_FDCWD, path, APPDIRS_O_DIR_HANDLE);
+		if (fd_valid && fd >= 0) {
+			fd = replace_dir_handle(handle.fd, fd);
+		}
+		dir_handles.erase(found);
+	}
+	else {
+		fd = openat(AT_FDCWD, path, APPDIRS_O_DIR_HANDLE);
+	}
+	struct stat fd_st;
+	if (fd >= 0 && !fstat(fd, &fd_st)) {
+		dir_handles[key] = { fd, fd_st.st_dev, fd_st.st_ino };
+	}
+	return fd;
+}
+
+static int open_user_dir(size_t length, const char* path, int* error)
+{
+	if (!length) {
+		return -1;
+	}
+	if (length >= PATH_MAX) {
+		if (error) {
+			*error = ENAMETOOLONG;
+		}
+		return -1;
+	}
+	const int fd = open_dir_handle(path, length);
+	if (error) {
+		*error = fd < 0 ? errno : 0;
+	}
+	return fd;
+}
+
+// Open the first existing entry of a site directory list.
+static int open_site_dir(
+    const bool config,
+    const AppDirsStr& appname,
+    const AppDirsStr& appauthor,
+    const AppDirsStr& version,
+    int* error)
+{
+	env_context env;
+	_CXTSTR storage;
+	const char* paths = get_site_dir_list(config, storage, env);
+	if (!paths) {
+		if (error) {
+			*error = errno;
+		}
+		return -1;
+	}
+	path_pieces suffix;
+	append_site_path(suffix, config, appname, appauthor, version);
+
+	char candidate[PATH_MAX];
+	int error_local = ENOENT;
+	const char* cursor = paths;
+	path_view entry;
+	while (nextMultiPath(cursor, entry)) {
+		path_output output(candidate, sizeof(candidate));
+		output.append(entry.str, entry.length);
+		output.append(suffix);
+		if (output.length() >= sizeof(candidate)) {
+			error_local = ENAMETOOLONG;
+			continue;
+		}
+		const int fd = open_dir_handle(candidate, output.length());
+		if (fd >= 0) {
+			if (error) {
+				*error = 0;
+			}
+			return fd;
+		}
+		error_local = errno;
+	}
+	if (error) {
+		*error = error_local;
+	}
+	return -1;
+}
+
+int open_user_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	char path[PATH_MAX];
+	return open_user_dir(user_data_dir(appname, appauthor, version, roaming, path, sizeof(path), error), path, error);
+}
+
+int open_site_data_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    int* error)
+{
+	return open_site_dir(false, appname, appauthor, version, error);
+}
+
+int open_user_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	char path[PATH_MAX];
+	return open_user_dir(user_config_dir(appname, appauthor, version, roaming, path, sizeof(path), error), path, error);
+}
+
+int open_site_config_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    int* error)
+{
+	return open_site_dir(true, appname, appauthor, version, error);
+}
+
+int open_user_cache_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    int* error)
+{
+	char path[PATH_MAX];
+	return open_user_dir(user_cache_dir(appname, appauthor, version, opinion, path, sizeof(path), error), path, error);
+}
+
+int open_user_state_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	char path[PATH_MAX];
+	return open_user_dir(user_state_dir(appname, appauthor, version, roaming, path, sizeof(path), error), path, error);
+}
+
+int open_user_log_dir(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    int* error)
+{
+	char path[PATH_MAX];
+	return open_user_dir(user_log_dir(appname, appauthor, version, opinion, path, sizeof(path), error), path, error);
+}
 #endif
+
+#if !defined(_WIN32)
+static const char* map_getenv(const char* name, const void* context)
+{
+	const std::map<std::string, std::string>& variables = *static_cast<const std::map<std::string, std::string>*>(context);
+	const auto variable = variables.find(name);
+	return variable != variables.end() ? variable->second.c_str() : nullptr;
+}
+
+AppDirsEnv::AppDirsEnv(const std::map<std::string, std::string>& variables, const char* home_)
+    : getenv(map_getenv), context(&variables), home(home_) {}
+
+_CXTSTR user_data_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_data_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	env_context env(&environment);
+	write_user_dir(output, env, roaming ? base_user_data_roaming : base_user_data_local, appname, appauthor, version, false, false, error);
+	return full_path;
+}
+
+std::vector<_CXTSTR> site_data_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(site_data_dir_calls);
+	env_context env(&environment);
+	return get_site_dirs(env, false, appname, appauthor, version, multipath, error);
+}
+
+_CXTSTR user_config_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_config_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	env_context env(&environment);
+	write_user_dir(output, env, user_config_base(roaming), appname, appauthor, version, false, false, error);
+	return full_path;
+}
+
+std::vector<_CXTSTR> site_config_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool multipath,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(site_config_dir_calls);
+	env_context env(&environment);
+	return get_site_dirs(env, true, appname, appauthor, version, multipath, error);
 }
 
 _CXTSTR user_cache_dir(
+    const AppDirsEnv& environment,
     const _CXTSTR* appname,
     const _CXTSTR* appauthor,
     const _CXTSTR* version,
     const bool opinion,
     int* error)
 {
+	APPDIRS_STAT_COUNT(user_cache_dir_calls);
 	_CXTSTR full_path;
+	path_output output(full_path);
+	env_context env(&environment);
+	write_user_dir(output, env, base_user_cache, appname, appauthor, version, opinion, false, error);
+	return full_path;
+}
 
-#if defined(_WIN32)
-	wins_getFolderPath(CSIDL_LOCAL_APPDATA, FOLDERID_LocalAppData, full_path);
-#elif defined(__APPLE__)
-	full_path = getUserDirectory() + "/Library/Caches";
+_CXTSTR user_state_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool roaming,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_state_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	env_context env(&environment);
+	write_user_dir(output, env, user_state_base(roaming), appname, appauthor, version, false, false, error);
+	return full_path;
+}
+
+_CXTSTR user_log_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const bool opinion,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_log_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	env_context env(&environment);
+	write_user_dir(output, env, user_log_base(), appname, appauthor, version, false, user_log_opinion(opinion), error);
+	return full_path;
+}
+
+_CXTSTR user_runtime_dir(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(user_runtime_dir_calls);
+	_CXTSTR full_path;
+	path_output output(full_path);
+	env_context env(&environment);
+	write_user_dir(output, env, base_user_runtime, appname, appauthor, version, false, false, error);
+	return full_path;
+}
+
+AppDirs resolve_all(
+    const AppDirsEnv& environment,
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const AppDirsOptions& options,
+    int* error)
+{
+	APPDIRS_STAT_COUNT(resolve_all_calls);
+	env_context env(&environment);
+	return resolve_all(env, appname, appauthor, version, options, error);
+}
+
+// Only one enumeration of the password database can be in progress per process.
+static std::mutex passwd_enumerate_mutex;
+
+std::vector<UserAppDirs> resolve_all_users(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const AppDirsOptions& options,
+    int* error)
+{
+	std::vector<UserAppDirs> users;
+	int rc = 0;
+
+	std::lock_guard<std::mutex> lock(passwd_enumerate_mutex);
+	setpwent();
+#if defined(__GLIBC__)
+	long buffer_size = sysconf(_SC_GETPW_R_SIZE_MAX);
+	std::vector<char> buffer(buffer_size > 0 ? static_cast<size_t>(buffer_size) : 1024);
+	passwd pw;
+	passwd* result = nullptr;
+	while (true) {
+		rc = getpwent_r(&pw, buffer.data(), buffer.size(), &result);
+		if (rc == ERANGE) {
+			buffer.resize(buffer.size() * 2);
+			continue;
+		}
+		if (rc || !result) {
+			break;
+		}
 #else
-	const char* path = getenv("XDG_CACHE_HOME");
-	if (path) {
-		full_path = path;
+	passwd* result;
+	while (true) {
+		errno = 0;
+		result = getpwent();
+		if (!result) {
+			rc = errno;
+			break;
+		}
+#endif
+		const AppDirsEnv environment(nullptr, nullptr, result->pw_dir ? result->pw_dir : "~");
+		env_context env(&environment);
+		users.push_back({ result->pw_uid, result->pw_name ? result->pw_name : "", resolve_all(env, appname, appauthor, version, options, nullptr) });
 	}
-	else {
-		full_path = getUserDirectory() + "/.cache";
+	endpwent();
+
+	// End of the database is reported as ENOENT by getpwent_r.
+	if (rc == ENOENT) {
+		rc = 0;
 	}
+	if (error) {
+		*error = rc;
+	}
+	return users;
+}
 #endif
 
-	if (full_path.empty()) {
-		if (error) {
-			*error = errno;
+#if defined(__linux__)
+#include <cstdio>
+#include <dirent.h>
+
+int ProcessEnv::read(const pid_t pid)
+{
+	char path[32];
+	snprintf(path, sizeof(path), "/proc/%d", static_cast<int>(pid));
+	const int dir_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir_fd < 0) {
+		return errno;
+	}
+	struct stat st;
+	const int fd = fstat(dir_fd, &st) ? -1 : openat(dir_fd, "environ", O_RDONLY | O_CLOEXEC);
+	const int rc = fd < 0 ? errno : 0;
+	close(dir_fd);
+	if (rc) {
+		return rc;
+	}
+
+	// Keep the buffer of the previous process, so a batch stays at the size of
+	// the largest environment. Most environments fit in a single read.
+	if (buffer_.size() < 4096) {
+		buffer_.resize(4096);
+	}
+	size_ = 0;
+	ssize_t count;
+	while ((count = ::read(fd, buffer_.data() + size_, buffer_.size() - size_ - 1)) > 0) {
+		size_ += static_cast<size_t>(count);
+		if (size_ + 1 == buffer_.size()) {
+			buffer_.resize(buffer_.size() * 2);
 		}
-		return full_path;
+	}
+	const int read_rc = count < 0 ? errno : 0;
+	close(fd);
+	buffer_[size_] = '\0';
+	if (read_rc) {
+		size_ = 0;
+		return read_rc;
 	}
 
-	const _CXTSTR& append_path_str = append_path_cache(appname, appauthor, version, opinion);
-	if (!append_path_str.empty()) {
-		full_path.append(append_path_str);
+	pid_ = pid;
+	uid_ = st.st_uid;
+	home_.clear();
+	if (!get("HOME") && getPasswdDirectory(uid_, home_)) {
+		home_ = "~";
 	}
+	return 0;
+}
 
-	if (error) {
-		*error = 0;
+const char* ProcessEnv::get(const char* name) const
+{
+	const size_t name_length = strlen(name);
+	const char* entry = buffer_.data();
+	const char* end = entry + size_;
+	while (entry < end) {
+		const size_t entry_length = strlen(entry);
+		if (entry_length > name_length && entry[name_length] == '=' && memcmp(entry, name, name_length) == 0) {
+			return entry + name_length + 1;
+		}
+		entry += entry_length + 1;
 	}
-	return full_path;
+	return nullptr;
 }
 
-_CXTSTR user_state_dir(
+const char* ProcessEnv::lookup(const char* name, const void* context)
+{
+	return static_cast<const ProcessEnv*>(context)->get(name);
+}
+
+int resolve_all_processes(
+    void (*callback)(pid_t pid, const AppDirs& dirs, void* context),
+    void* context,
     const _CXTSTR* appname,
     const _CXTSTR* appauthor,
     const _CXTSTR* version,
-    const bool roaming,
-    int* error)
+    const AppDirsOptions& options)
 {
-#if defined(_WIN32) || defined(__APPLE__)
-	// same as user_data_dir
-	return user_data_dir(appname, appauthor, version, roaming, error);
-#else
-	_CXTSTR full_path;
+	DIR* proc = opendir("/proc");
+	if (!proc) {
+		return errno;
+	}
+	ProcessEnv process;
+	dirent* entry;
+	while ((entry = readdir(proc))) {
+		char* end;
+		const long pid = strtol(entry->d_name, &end, 10);
+		if (*end || pid <= 0) {
+			continue;
+		}
+		// Processes may exit or deny access while iterating, skip them.
+		if (process.read(static_cast<pid_t>(pid))) {
+			continue;
+		}
+		const AppDirsEnv environment = process.environment();
+		env_context env(&environment);
+		callback(process.pid(), resolve_all(env, appname, appauthor, version, options, nullptr), context);
+	}
+	closedir(proc);
+	return 0;
+}
+#endif
 
-	const char* path = getenv("XDG_STATE_HOME");
-	if (path) {
-		full_path = path;
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+
+static const uint32_t config_watch_events = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+// Events of the closest existing parent of a missing directory, telling the path may now exist.
+static const uint32_t config_parent_events = IN_CREATE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+// Add a change, or merge it with the change of the same file already in this batch.
+static void add_config_change(std::vector<ConfigChange>& changes, const size_t first, const size_t level, const char* name, const uint32_t events)
+{
+	auto change = changes.begin() + first;
+	while (change != changes.end() && !(change->level == level && change->name == name)) {
+		++change;
+	}
+	if (change != changes.end()) {
+		change->events |= events;
 	}
 	else {
-		full_path = getUserDirectory() + "/.local/state";
+		changes.push_back({ level, name, events });
+	}
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+	stop();
+}
+
+void ConfigWatcher::stop()
+{
+	if (fd_ >= 0) {
+		close(fd_);
+		fd_ = -1;
 	}
+	directories_.clear();
+	watches_.clear();
+}
 
-	if (full_path.empty()) {
-		if (error) {
-			*error = errno;
+void ConfigWatcher::release_watch(const int watch)
+{
+	if (watch < 0) {
+		return;
+	}
+	// Watches of the same inode share a descriptor, only remove it once no level uses it.
+	for (const level_watch& level : watches_) {
+		if (level.watch == watch || level.parent == watch) {
+			return;
 		}
-		return full_path;
 	}
+	inotify_rm_watch(fd_, watch);
+}
+
+bool ConfigWatcher::watch_level(const size_t level)
+{
+	level_watch& watch = watches_[level];
+	const std::string& directory = directories_[level];
+	const int previous_parent = watch.parent;
+	watch.parent = -1;
+	size_t last_length = std::string::npos;
+	while (!directory.empty()) {
+		watch.watch = inotify_add_watch(fd_, directory.c_str(), config_watch_events | IN_MOVE_SELF | IN_ONLYDIR | IN_MASK_ADD);
+		if (watch.watch >= 0) {
+			watch.parent = -1;
+			break;
+		}
+		// Watch the closest existing parent, to learn when the next missing piece appears.
+		const int error = errno;
+		size_t length = directory.length();
+		while (length > 0 && watch.parent < 0) {
+			length = directory.rfind('/', length - 1);
+			if (length == std::string::npos) {
+				break;
+			}
+			const std::string parent = length ? directory.substr(0, length) : std::string("/");
+			watch.parent = inotify_add_watch(fd_, parent.c_str(), config_parent_events | IN_ONLYDIR | IN_MASK_ADD);
+			watch.parent_length = length;
+		}
+		if (watch.parent < 0 || watch.parent_length == last_length) {
+			errno = error;
+			break;
+		}
+		// A piece created before the parent was watched is never reported, so look again,
+		// as long as the watched parent gets closer.
+		last_length = watch.parent_length;
+		const size_t end = directory.find('/', directory.find_first_not_of('/', watch.parent_length));
+		struct stat st;
+		if (stat(directory.substr(0, end).c_str(), &st) || !S_ISDIR(st.st_mode)) {
+			errno = error;
+			break;
+		}
+		const int parent = watch.parent;
+		watch.parent = -1;
+		release_watch(parent);
+	}
+	if (previous_parent != watch.parent) {
+		release_watch(previous_parent);
+	}
+	return watch.watch >= 0;
+}
 
-	const _CXTSTR& append_path_str = append_path(appname, nullptr, version);
-	if (!append_path_str.empty()) {
-		full_path.append(append_path_str);
+int ConfigWatcher::start(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version)
+{
+	stop();
+	int error = 0;
+	// Level 0 is kept even if it failed to resolve, so levels match the cascade.
+	directories_.push_back(user_config_dir(appname, appauthor, version, false, &error));
+	for (const std::string& site_dir : site_config_dir(appname, appauthor, version, true, &error)) {
+		directories_.push_back(site_dir);
 	}
 
-	if (error) {
-		*error = 0;
+	fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd_ < 0) {
+		error = errno;
+		directories_.clear();
+		return error;
 	}
-	return full_path;
+	watches_.assign(directories_.size(), level_watch());
+	bool watching = false;
+	error = ENOENT;
+	for (size_t level = 0; level < directories_.size(); level++) {
+		if (watch_level(level) || watches_[level].parent >= 0) {
+			watching = true;
+		}
+		else if (!directories_[level].empty()) {
+			error = errno;
+		}
+	}
+	if (!watching) {
+		stop();
+		return error;
+	}
+	return 0;
+}
+
+size_t ConfigWatcher::read_changes(std::vector<ConfigChange>& changes, const int timeout_ms, const int coalesce_ms)
+{
+	if (fd_ < 0) {
+		return 0;
+	}
+	const size_t first = changes.size();
+	pollfd pfd = { fd_, POLLIN, 0 };
+	if (poll(&pfd, 1, timeout_ms) <= 0) {
+		return 0;
+	}
+	// Let the rest of the burst arrive, then read a single batch.
+	if (coalesce_ms > 0) {
+		poll(nullptr, 0, coalesce_ms);
+	}
+	alignas(inotify_event) char buffer[16384];
+	const ssize_t count = read(fd_, buffer, sizeof(buffer));
+	if (count <= 0) {
+		return 0;
+	}
+	for (char* cursor = buffer; cursor < buffer + count;) {
+		const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+		cursor += sizeof(inotify_event) + event->len;
+		if (event->mask & IN_Q_OVERFLOW) {
+			changes.push_back({ ConfigChange::rescan, std::string(), IN_Q_OVERFLOW });
+			// The creation of a missing directory may be among the lost events.
+			for (size_t level = 0; level < watches_.size(); level++) {
+				if (watches_[level].parent >= 0 && watch_level(level)) {
+					add_config_change(changes, first, level, "", IN_CREATE);
+				}
+			}
+			continue;
+		}
+		for (size_t level = 0; level < watches_.size(); level++) {
+			level_watch& watch = watches_[level];
+			if (event->wd == watch.watch) {
+				if (event->mask & (IN_IGNORED | IN_MOVE_SELF)) {
+					// The directory was removed or moved away, wait for it to appear again.
+					const int removed = watch.watch;
+					watch.watch = -1;
+					release_watch(removed);
+					add_config_change(changes, first, level, "", IN_IGNORED);
+					if (watch_level(level)) {
+						add_config_change(changes, first, level, "", IN_CREATE);
+					}
+				}
+				else if (event->len && (event->mask & config_watch_events)) {
+					add_config_change(changes, first, level, event->name, event->mask & config_watch_events);
+				}
+			}
+			else if (event->wd == watch.parent) {
+				bool next = (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) != 0;
+				if (!next && event->len) {
+					// Only the next piece of the missing path matters.
+					const std::string& directory = directories_[level];
+					const size_t begin = directory.find_first_not_of('/', watch.parent_length);
+					const size_t end = std::min(directory.find('/', begin), directory.length());
+					next = begin != std::string::npos && directory.compare(begin, end - begin, event->name) == 0;
+				}
+				if (next && watch_level(level)) {
+					add_config_change(changes, first, level, "", IN_CREATE);
+				}
+			}
+		}
+	}
+	return changes.size() - first;
+}
+
+size_t ConfigWatcher::read_changes(void (*callback)(const ConfigChange& change, void* context), void* context, const int timeout_ms, const int coalesce_ms)
+{
+	std::vector<ConfigChange> changes;
+	read_changes(changes, timeout_ms, coalesce_ms);
+	for (const ConfigChange& change : changes) {
+		callback(change, context);
+	}
+	return changes.size();
+}
 #endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+
+// Layout of the records returned by getdents64.
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1];
+};
+
+// Read the names of a directory, excluding "." and "..". Returns 0 or the errno value.
+static int read_dir_names(const int fd, std::vector<std::string>& names)
+{
+	names.clear();
+	alignas(linux_dirent64) char buffer[32768];
+	long count;
+	while ((count = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0) {
+		for (long offset = 0; offset < count;) {
+			const linux_dirent64* record = reinterpret_cast<const linux_dirent64*>(buffer + offset);
+			offset += record->d_reclen;
+			const char* name = record->d_name;
+			if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]))) {
+				continue;
+			}
+			names.emplace_back(name);
+		}
+	}
+	return count < 0 ? errno : 0;
 }
 
-_CXTSTR user_log_dir(
+int DataIndex::build(
     const _CXTSTR* appname,
     const _CXTSTR* appauthor,
     const _CXTSTR* version,
-    const bool opinion,
-    int* error)
+    const _CXTSTR* subdir)
 {
-	int error_local;
-	_CXTSTR full_path;
-#if defined(_WIN32)
-	full_path = user_data_dir(appname, appauthor, version, false, &error_local);
-#elif !defined(__APPLE__)
-	full_path = user_cache_dir(appname, appauthor, version, true, &error_local);
-#else
-	full_path = getUserDirectory() + "/Library/Logs";
-
-	const _CXTSTR& append_path_str = append_path(appname, appauthor, version);
-	if (!append_path_str.empty()) {
-		full_path.append(append_path_str);
+	paths_.clear();
+	// Level 0 is kept even if it failed to resolve, so levels match the cascade.
+	paths_.push_back(user_data_dir(appname, appauthor, version, false));
+	for (std::string& site_dir : site_data_dir(appname, appauthor, version, true)) {
+		paths_.push_back(std::move(site_dir));
 	}
-	if (error_local) {
-		if (error) {
-			*error = error_local;
+	dirs_.clear();
+	for (std::string& path : paths_) {
+		if (subdir && !path.empty()) {
+			path += slash_cat;
+			path += *subdir;
 		}
-		return full_path;
+		dirs_.push_back({ path, 0, 0, {} });
 	}
-#endif
+	return scan(true);
+}
 
-#if !defined(__APPLE__)
-	if (opinion) {
-		full_path.append(slash_cat log_str);
+int DataIndex::refresh()
+{
+	return scan(false);
+}
+
+int DataIndex::scan(const bool force)
+{
+	int error = 0;
+	bool changed = force;
+	for (directory& dir : dirs_) {
+		const int fd = dir.path.empty() ? -1 : open(dir.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st)) {
+			const int rc = dir.path.empty() ? ENOENT : errno;
+			if (fd >= 0) {
+				close(fd);
+			}
+			if (rc != ENOENT && !error) {
+				error = rc;
+			}
+			// Missing directory indexes nothing.
+			if (dir.mtime_sec || dir.mtime_nsec || !dir.names.empty()) {
+				dir.mtime_sec = dir.mtime_nsec = 0;
+				dir.names.clear();
+				changed = true;
+			}
+			continue;
+		}
+		// Adding, removing, or renaming an entry updates the directory's modification time.
+		if (force || st.st_mtim.tv_sec != dir.mtime_sec || st.st_mtim.tv_nsec != dir.mtime_nsec) {
+			const int rc = read_dir_names(fd, dir.names);
+			if (rc && !error) {
+				error = rc;
+			}
+			dir.mtime_sec = st.st_mtim.tv_sec;
+			dir.mtime_nsec = st.st_mtim.tv_nsec;
+			changed = true;
+		}
+		close(fd);
+	}
+	if (!changed) {
+		return error;
 	}
-#endif
 
-	if (error) {
-		*error = error_local;
+	// Merge from the highest precedence, so the first directory with a name wins.
+	entries_.clear();
+	for (size_t level = 0; level < dirs_.size(); level++) {
+		for (const std::string& name : dirs_[level].names) {
+			if (entries_.count(name)) {
+				continue;
+			}
+			entry& winner = entries_[name];
+			winner.path.reserve(dirs_[level].path.length() + 1 + name.length());
+			winner.path = dirs_[level].path;
+			winner.path += slash_cat;
+			winner.path += name;
+			winner.level = level;
+		}
 	}
-	return full_path;
+	generation_++;
+	return error;
 }
+#endif
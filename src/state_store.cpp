@@ -0,0 +1,444 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include "AppDirsCPP.hpp"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Record layout, in both the data file and the journal:
+// key length, value length (erase_length for an erase), CRC-32 of key and value, key, value.
+const uint32_t erase_length = 0xFFFFFFFF;
+const size_t record_header = 12;
+const char data_magic[8] = { 'A', 'D', 'S', 'T', 'A', 'T', 'E', '1' };
+
+uint32_t crc32_update(uint32_t crc, const char* data, const size_t length)
+{
+	static uint32_t table[256];
+	static std::once_flag table_once;
+	std::call_once(table_once, []() {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) {
+				c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			}
+			table[i] = c;
+		}
+	});
+	for (size_t i = 0; i < length; i++) {
+		crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+uint32_t record_crc(const char* key, const size_t key_length, const char* value, const size_t value_length)
+{
+	return ~crc32_update(crc32_update(0xFFFFFFFF, key, key_length), value, value_length);
+}
+
+void append_record(std::string& out, const std::string& key, const std::string* value)
+{
+	const uint32_t lengths[3] = {
+		static_cast<uint32_t>(key.size()),
+		value ? static_cast<uint32_t>(value->size()) : erase_length,
+		record_crc(key.data(), key.size(), value ? value->data() : nullptr, value ? value->size() : 0),
+	};
+	out.append(reinterpret_cast<const char*>(lengths), sizeof(lengths));
+	out += key;
+	if (value) {
+		out += *value;
+	}
+}
+
+// Apply every valid record of data to entries. Returns the length of the valid prefix.
+size_t replay(const char* data, const size_t size, std::unordered_map<std::string, std::string>& entries)
+{
+	size_t offset = 0;
+	while (size - offset >= record_header) {
+		uint32_t lengths[3];
+		memcpy(lengths, data + offset, sizeof(lengths));
+		const size_t value_length = lengths[1] == erase_length ? 0 : lengths[1];
+		if (size - offset - record_header < static_cast<size_t>(lengths[0]) + value_length) {
+			break;
+		}
+		const char* key = data + offset + record_header;
+		const char* value = key + lengths[0];
+		if (record_crc(key, lengths[0], value, value_length) != lengths[2]) {
+			break;
+		}
+		if (lengths[1] == erase_length) {
+			entries.erase(std::string(key, lengths[0]));
+		}
+		else {
+			entries[std::string(key, lengths[0])].assign(value, value_length);
+		}
+		offset += record_header + lengths[0] + value_length;
+	}
+	return offset;
+}
+
+// Map a whole file read-only and replay it. Returns the length of the valid prefix, or 0 if missing.
+size_t replay_file(const int dir_fd, const std::string& name, const size_t skip, std::unordered_map<std::string, std::string>& entries, int& fd_out)
+{
+	fd_out = openat(dir_fd, name.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd_out < 0) {
+		return 0;
+	}
+	struct stat st;
+	if (fstat(fd_out, &st) || static_cast<size_t>(st.st_size) <= skip) {
+		return 0;
+	}
+	const size_t size = static_cast<size_t>(st.st_size);
+	void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd_out, 0);
+	if (map == MAP_FAILED) {
+		return 0;
+	}
+	madvise(map, size, MADV_SEQUENTIAL);
+	const char* data = static_cast<const char*>(map);
+	size_t valid = 0;
+	if (!skip || memcmp(data, data_magic, sizeof(data_magic)) == 0) {
+		valid = skip + replay(data + skip, size - skip, entries);
+	}
+	munmap(map, size);
+	return valid;
+}
+
+bool write_all(const int fd, const char* data, size_t size)
+{
+	while (size) {
+		const ssize_t count = write(fd, data, size);
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += count;
+		size -= static_cast<size_t>(count);
+	}
+	return true;
+}
+
+} // namespace
+
+struct StateStore::impl {
+	std::string directory;
+	std::string data_name;
+	std::string journal_name;
+	std::string old_journal_name;
+	int dir_fd = -1;
+	int journal_fd = -1;
+	uint64_t journal_bytes = 0;
+	uint64_t compact_bytes = 0;
+
+	// Held while writing the journal, so batches are appended in order.
+	std::mutex journal_mutex;
+	// Entries as of the last durable batch. Requires journal_mutex.
+	std::unordered_map<std::string, std::string> committed;
+	// Held while reading or updating entries and pending.
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, std::string> entries;
+	std::string pending;
+
+	// Held for a whole compaction, so only one data file is written at a time.
+	std::mutex compact_mutex;
+	// The old journal is not yet in the data file, so it must not be replaced. Requires compact_mutex.
+	bool old_journal = false;
+	std::condition_variable wake;
+	bool stopping = false;
+	bool compact_requested = false;
+	std::thread compactor;
+
+	// Open the journal, then make its directory entry durable in case it was created.
+	int open_journal()
+	{
+		journal_fd = openat(dir_fd, journal_name.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+		if (journal_fd < 0 || fsync(dir_fd)) {
+			return errno;
+		}
+		return 0;
+	}
+
+	// Write pending with one write and one fdatasync. Requires journal_mutex.
+	int write_pending()
+	{
+		std::string batch;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			batch.swap(pending);
+		}
+		if (batch.empty()) {
+			return 0;
+		}
+		if (!write_all(journal_fd, batch.data(), batch.size()) || fdatasync(journal_fd)) {
+			return errno;
+		}
+		journal_bytes += batch.size();
+		replay(batch.data(), batch.size(), committed);
+		return 0;
+	}
+
+	// Replace the data file with out through a temporary file, durable once this returns 0.
+	int write_data(const std::string& out)
+	{
+		const std::string temp_name = data_name + ".tmp";
+		const int fd = openat(dir_fd, temp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+		if (fd < 0) {
+			return errno;
+		}
+		int rc = write_all(fd, out.data(), out.size()) && !fsync(fd) ? 0 : errno;
+		::close(fd);
+		if (!rc && renameat(dir_fd, temp_name.c_str(), dir_fd, data_name.c_str())) {
+			rc = errno;
+		}
+		if (rc) {
+			unlinkat(dir_fd, temp_name.c_str(), 0);
+			return rc;
+		}
+		return fsync(dir_fd) ? errno : 0;
+	}
+
+	// Replace the data file with the committed entries and drop the journal.
+	int compact()
+	{
+		std::lock_guard<std::mutex> compact_lock(compact_mutex);
+		std::string out(data_magic, sizeof(data_magic));
+		std::unique_lock<std::mutex> journal_lock(journal_mutex);
+		for (const auto& entry : committed) {
+			append_record(out, entry.first, &entry.second);
+		}
+		if (old_journal) {
+			// Left by an interrupted compaction: finish in place, never move a journal over it.
+			int rc = write_data(out);
+			if (rc) {
+				return rc;
+			}
+			unlinkat(dir_fd, old_journal_name.c_str(), 0);
+			old_journal = false;
+			rc = ftruncate(journal_fd, 0) ? errno : 0;
+			if (!rc) {
+				journal_bytes = 0;
+			}
+			return rc;
+		}
+
+		// Move the journal aside, so writers continue with a new one while the data file is written.
+		if (renameat(dir_fd, journal_name.c_str(), dir_fd, old_journal_name.c_str())) {
+			return errno;
+		}
+		old_journal = true;
+		::close(journal_fd);
+		int rc = open_journal();
+		journal_bytes = 0;
+		journal_lock.unlock();
+		if (rc) {
+			return rc;
+		}
+
+		// The old journal is replayed on open until the data file is durable.
+		rc = write_data(out);
+		if (rc) {
+			return rc;
+		}
+		unlinkat(dir_fd, old_journal_name.c_str(), 0);
+		old_journal = false;
+		return 0;
+	}
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [this]() { return stopping || compact_requested; });
+			if (stopping) {
+				return;
+			}
+			compact_requested = false;
+			lock.unlock();
+			compact();
+			lock.lock();
+		}
+	}
+};
+
+StateStore::StateStore()
+    : impl_(new impl) {}
+
+StateStore::~StateStore()
+{
+	close();
+}
+
+int StateStore::open(
+    const _CXTSTR* appname,
+    const _CXTSTR* appauthor,
+    const _CXTSTR* version,
+    const std::string& name,
+    const uint64_t compact_bytes)
+{
+	close();
+	if (name.empty() || name.find('/') != std::string::npos) {
+		return EINVAL;
+	}
+	int error = 0;
+	std::string directory = ensure_user_state_dir(appname, appauthor, version, false, &error);
+	if (directory.empty()) {
+		return error ? error : ENOENT;
+	}
+	impl_->dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (impl_->dir_fd < 0) {
+		return errno;
+	}
+	impl_->directory = std::move(directory);
+	impl_->data_name = name + ".db";
+	impl_->journal_name = name + ".journal";
+	impl_->old_journal_name = name + ".journal.old";
+	impl_->compact_bytes = compact_bytes;
+
+	// Data file, then a journal left by an interrupted compaction, then the journal.
+	int fd;
+	replay_file(impl_->dir_fd, impl_->data_name, sizeof(data_magic), impl_->entries, fd);
+	if (fd >= 0) {
+		::close(fd);
+	}
+	replay_file(impl_->dir_fd, impl_->old_journal_name, 0, impl_->entries, fd);
+	impl_->old_journal = fd >= 0;
+	if (fd >= 0) {
+		::close(fd);
+	}
+	const size_t valid = replay_file(impl_->dir_fd, impl_->journal_name, 0, impl_->entries, fd);
+	if (fd >= 0) {
+		::close(fd);
+	}
+
+	error = impl_->open_journal();
+	if (error) {
+		close();
+		return error;
+	}
+	// Drop a record torn by a crash, so new records are not appended after it.
+	struct stat st;
+	if (!fstat(impl_->journal_fd, &st) && static_cast<size_t>(st.st_size) > valid) {
+		if (ftruncate(impl_->journal_fd, static_cast<off_t>(valid))) {
+			error = errno;
+			close();
+			return error;
+		}
+	}
+	impl_->journal_bytes = valid;
+	impl_->committed = impl_->entries;
+	// Write the data file from the merged entries before anything could replace the old journal.
+	if (impl_->old_journal) {
+		error = impl_->compact();
+		if (error) {
+			close();
+			return error;
+		}
+	}
+	impl_->compactor = std::thread(&impl::run, impl_.get());
+	return 0;
+}
+
+void StateStore::close()
+{
+	if (impl_->compactor.joinable()) {
+		commit();
+		{
+			std::lock_guard<std::mutex> lock(impl_->mutex);
+			impl_->stopping = true;
+		}
+		impl_->wake.notify_all();
+		impl_->compactor.join();
+		impl_->stopping = false;
+		impl_->compact_requested = false;
+	}
+	if (impl_->journal_fd >= 0) {
+		::close(impl_->journal_fd);
+		impl_->journal_fd = -1;
+	}
+	if (impl_->dir_fd >= 0) {
+		::close(impl_->dir_fd);
+		impl_->dir_fd = -1;
+	}
+	impl_->entries.clear();
+	impl_->committed.clear();
+	impl_->pending.clear();
+	impl_->directory.clear();
+	impl_->old_journal = false;
+}
+
+bool StateStore::get(const std::string& key, std::string& value) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex);
+	const auto found = impl_->entries.find(key);
+	if (found == impl_->entries.end()) {
+		return false;
+	}
+	value = found->second;
+	return true;
+}
+
+void StateStore::set(const std::string& key, const std::string& value)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex);
+	impl_->entries[key] = value;
+	append_record(impl_->pending, key, &value);
+}
+
+void StateStore::erase(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex);
+	if (impl_->entries.erase(key)) {
+		append_record(impl_->pending, key, nullptr);
+	}
+}
+
+int StateStore::commit()
+{
+	if (impl_->journal_fd < 0) {
+		return EBADF;
+	}
+	int rc;
+	bool compact;
+	{
+		std::lock_guard<std::mutex> journal_lock(impl_->journal_mutex);
+		rc = impl_->write_pending();
+		compact = impl_->compact_bytes && impl_->journal_bytes > impl_->compact_bytes;
+	}
+	if (compact) {
+		std::lock_guard<std::mutex> lock(impl_->mutex);
+		impl_->compact_requested = true;
+		impl_->wake.notify_one();
+	}
+	return rc;
+}
+
+int StateStore::compact()
+{
+	const int rc = commit();
+	return rc ? rc : impl_->compact();
+}
+
+size_t StateStore::size() const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex);
+	return impl_->entries.size();
+}
+
+const std::string& StateStore::directory() const
+{
+	return impl_->directory;
+}
+#endif
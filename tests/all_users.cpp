@@ -0,0 +1,52 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+#if !defined(_WIN32)
+#include <pwd.h>
+#include <unistd.h>
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if !defined(_WIN32)
+	int error = 0;
+	const std::vector<UserAppDirs> users = resolve_all_users(&AppDirsCPP_cstr, nullptr, nullptr, AppDirsOptions(), &error);
+	cout << (!error && !users.empty() ? "PASS! " : (error_count++, "FAIL! ")) << "resolve_all_users; count = " << users.size() << "; error = " << error << ";\n";
+
+	// Every record must match resolving with the account's home directory.
+	for (const UserAppDirs& user : users) {
+		const passwd* pw = getpwuid(user.uid);
+		if (!pw) {
+			continue;
+		}
+		std::map<std::string, std::string> variables;
+		const AppDirsEnv environment(variables, pw->pw_dir);
+		const AppDirs expected = resolve_all(environment, &AppDirsCPP_cstr);
+		bool match = true;
+		for (int id = 0; id < AppDirs::dir_count; id++) {
+			const AppDirs::dir dir_id = static_cast<AppDirs::dir>(id);
+			match = match && user.dirs.str(dir_id) == expected.str(dir_id);
+		}
+		if (!match) {
+			error_count++;
+		}
+		cout << (match ? "PASS! " : "FAIL! ") << "user[" << user.uid << "] " << user.name << "; user_data_dir = " << user.dirs.get(AppDirs::user_data) << ";\n";
+	}
+
+	// The current account must be present.
+	bool found = false;
+	for (const UserAppDirs& user : users) {
+		found = found || user.uid == getuid();
+	}
+	cout << (found ? "PASS! " : (error_count++, "FAIL! ")) << "current uid " << getuid() << " found;\n";
+#endif
+	return error_count;
+}
@@ -0,0 +1,68 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+static constexpr _CXTCHAR app_name[] = AppDirsCPP_str;
+static constexpr _CXTCHAR app_author[] = AppAuthor_str;
+static constexpr _CXTCHAR app_version[] = version_str;
+
+static _CXTSTR join_paths(const std::vector<_CXTSTR>& full_paths)
+{
+	_CXTSTR joined;
+	for (const auto& full_path : full_paths) {
+		if (!joined.empty()) {
+			joined += pathsep;
+		}
+		joined += full_path;
+	}
+	return joined;
+}
+
+static int expect_equal(const char* name, const bool option, const _CXTSTR& result, const _CXTSTR& expected)
+{
+	if (result == expected) {
+		cout << "PASS! ";
+	}
+	else {
+		cout << "FAIL! ";
+	}
+	cout << name << "(" << option << "); full_path = " << result << ";\n";
+	return result == expected ? 0 : 1;
+}
+
+template<typename Dirs>
+static int test_app_dirs(const _CXTSTR* appauthor, const _CXTSTR* version)
+{
+	int error_count = 0;
+	for (int option = 0; option < 2; option++) {
+		error_count += expect_equal("user_data_dir", option, Dirs::user_data_dir(option), user_data_dir(&AppDirsCPP_cstr, appauthor, version, option));
+		error_count += expect_equal("site_data_dir", option, Dirs::site_data_dir(option), join_paths(site_data_dir(&AppDirsCPP_cstr, appauthor, version, option)));
+		error_count += expect_equal("user_config_dir", option, Dirs::user_config_dir(option), user_config_dir(&AppDirsCPP_cstr, appauthor, version, option));
+		error_count += expect_equal("site_config_dir", option, Dirs::site_config_dir(option), join_paths(site_config_dir(&AppDirsCPP_cstr, appauthor, version, option)));
+		error_count += expect_equal("user_cache_dir", option, Dirs::user_cache_dir(option), user_cache_dir(&AppDirsCPP_cstr, appauthor, version, option));
+		error_count += expect_equal("user_state_dir", option, Dirs::user_state_dir(option), user_state_dir(&AppDirsCPP_cstr, appauthor, version, option));
+		error_count += expect_equal("user_log_dir", option, Dirs::user_log_dir(option), user_log_dir(&AppDirsCPP_cstr, appauthor, version, option));
+	}
+	return error_count;
+}
+
+#if !defined(_WIN32)
+// Suffix is built at compile time.
+static_assert(AppDirsFor<app_name, app_author, app_version>::path_suffix_length() == sizeof(AppDirsCPP_cat version_cat) - 1, "suffix length");
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+	error_count += test_app_dirs<AppDirsFor<app_name>>(nullptr, nullptr);
+	error_count += test_app_dirs<AppDirsFor<app_name, app_author>>(&AppAuthor_cstr, nullptr);
+	error_count += test_app_dirs<AppDirsFor<app_name, nullptr, app_version>>(nullptr, &version_cstr);
+	error_count += test_app_dirs<AppDirsFor<app_name, app_author, app_version>>(&AppAuthor_cstr, &version_cstr);
+	return error_count;
+}
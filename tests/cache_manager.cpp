@@ -0,0 +1,103 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+#include "internal.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Write size bytes and set the access time to seconds since the epoch.
+static void write_file(const _CXTSTR& path, const size_t size, const time_t atime)
+{
+	const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	const std::string data(size, 'x');
+	if (write(fd, data.data(), data.size()) < 0) {
+		cout << "ERROR: write " << path << ";\n";
+	}
+	const timespec times[2] = { { atime, 0 }, { atime, 0 } };
+	futimens(fd, times);
+	close(fd);
+}
+
+static bool exists(const _CXTSTR& path)
+{
+	return access(path.c_str(), F_OK) == 0;
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if !defined(__linux__)
+	cout << "SKIP! CacheManager is only available on Linux.\n";
+#else
+	char root_template[] = "/tmp/AppDirsCPP_cache_XXXXXX";
+	const _CXTSTR root = mkdtemp(root_template);
+	setenv("XDG_CACHE_HOME", root.c_str(), 1);
+	const _CXTSTR cache = ensure_user_cache_dir(&AppDirsCPP_cstr);
+	const _CXTSTR log = ensure_user_log_dir(&AppDirsCPP_cstr);
+	mkdir((cache + "/a").c_str(), 0700);
+	mkdir((cache + "/b").c_str(), 0700);
+	mkdir((cache + "/b/c").c_str(), 0700);
+	write_file(cache + "/top", 100, 1000);
+	write_file(cache + "/a/oldest", 100, 10);
+	write_file(cache + "/a/newer", 100, 2000);
+	write_file(cache + "/b/c/old", 100, 20);
+	write_file(log + "/app.log", 1000, 1);
+
+	CacheManager manager;
+	int error = manager.open(&AppDirsCPP_cstr, nullptr, nullptr, 400, 0, 2);
+	error_count += expect("open", !error && manager.directory() == cache);
+	error_count += expect("scan skips log dir", manager.entries() == 4 && manager.bytes() == 400);
+
+	// Over budget by one file: the oldest is evicted, the touched one is kept.
+	manager.touch("b/c/old");
+	write_file(cache + "/b/new", 100, 3000);
+	error = manager.record("b/new");
+	for (int attempt = 0; attempt < 100 && manager.bytes() > 400; attempt++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	error_count += expect("record", !error && manager.entries() == 4 && manager.bytes() == 400);
+	error_count += expect("background eviction", !exists(cache + "/a/oldest") && exists(cache + "/b/c/old") && exists(cache + "/b/new"));
+	error_count += expect("log kept", exists(log + "/app.log"));
+
+	// Growing a file is accounted, evict without waiting.
+	write_file(cache + "/top", 250, 4000);
+	manager.record("top");
+	manager.evict();
+	error_count += expect("evict", manager.bytes() <= 400 && exists(cache + "/top"));
+	error_count += expect("missing file", manager.record("none") == ENOENT);
+
+	// Records racing background eviction never leave an entry without its file.
+	mkdir((cache + "/s").c_str(), 0700);
+	std::thread producers[2];
+	for (int p = 0; p < 2; p++) {
+		producers[p] = std::thread([&, p]() {
+			for (int n = 0; n < 500; n++) {
+				const std::string name = "s/" + std::to_string((n + p) % 8);
+				write_file(cache + "/" + name, 100, 5000 + n);
+				manager.record(name);
+			}
+		});
+	}
+	for (std::thread& producer : producers) {
+		producer.join();
+	}
+	manager.evict();
+	const size_t tracked = manager.entries();
+	const uint64_t tracked_bytes = manager.bytes();
+	manager.close();
+	manager.open(&AppDirsCPP_cstr, nullptr, nullptr, 400, 0, 2);
+	error_count += expect("record racing eviction", manager.entries() == tracked && manager.bytes() == tracked_bytes);
+#endif
+	return error_count;
+}
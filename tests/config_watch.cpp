@@ -0,0 +1,141 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "internal.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+static void write_file(const _CXTSTR& path)
+{
+	const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (write(fd, "key=value\n", 10) < 0) {
+		cout << "ERROR: write " << path << ";\n";
+	}
+	close(fd);
+}
+
+// Read changes until one of level and name has events, or a second passed without it.
+static bool wait_change(ConfigWatcher& watcher, const size_t level, const _CXTSTR& name, const uint32_t events)
+{
+	std::vector<ConfigChange> changes;
+	while (watcher.read_changes(changes, 1000)) {
+		for (const ConfigChange& change : changes) {
+			if (change.level == level && change.name == name && (change.events & events)) {
+				return true;
+			}
+		}
+		changes.clear();
+	}
+	return false;
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if !defined(__linux__)
+	cout << "SKIP! ConfigWatcher is only available on Linux.\n";
+#else
+	char root_template[] = "/tmp/AppDirsCPP_watch_XXXXXX";
+	const _CXTSTR root = mkdtemp(root_template);
+	setenv("XDG_CONFIG_HOME", (root + "/user").c_str(), 1);
+	setenv("XDG_CONFIG_DIRS", (root + "/missing:" + root + "/site").c_str(), 1);
+	const _CXTSTR user_dir = ensure_user_config_dir(&AppDirsCPP_cstr);
+	const _CXTSTR site_dir = root + "/site" AppDirsCPP_cat;
+	mkdir((root + "/site").c_str(), 0700);
+	mkdir(site_dir.c_str(), 0700);
+
+	ConfigWatcher watcher;
+	int error = watcher.start(&AppDirsCPP_cstr);
+	const bool started = !error && watcher.fd() >= 0 && watcher.directories().size() == 3 && watcher.directories()[0] == user_dir && watcher.directories()[2] == site_dir;
+	cout << (started ? "PASS! " : (error_count++, "FAIL! ")) << "start; error = " << error << "; directories = " << watcher.directories().size() << ";\n";
+
+	std::vector<ConfigChange> changes;
+	cout << (watcher.read_changes(changes) == 0 ? "PASS! " : (error_count++, "FAIL! ")) << "no changes pending;\n";
+
+	// A burst of writes to one file is coalesced into one change per level.
+	for (int n = 0; n < 5; n++) {
+		write_file(user_dir + "/settings.ini");
+	}
+	write_file(site_dir + "/defaults.ini");
+	rename((site_dir + "/defaults.ini").c_str(), (site_dir + "/renamed.ini").c_str());
+	watcher.read_changes(changes, 1000);
+
+	const bool coalesced = changes.size() == 3
+	    && changes[0].level == 0 && changes[0].name == "settings.ini" && (changes[0].events & IN_CLOSE_WRITE)
+	    && changes[1].level == 2 && changes[1].name == "defaults.ini" && (changes[1].events & IN_MOVED_FROM)
+	    && changes[2].level == 2 && changes[2].name == "renamed.ini" && (changes[2].events & IN_MOVED_TO);
+	cout << (coalesced ? "PASS! " : (error_count++, "FAIL! ")) << "read_changes; count = " << changes.size() << ";\n";
+	for (const ConfigChange& change : changes) {
+		cout << "INFO : level " << change.level << "; name = " << change.name << "; events = " << change.events << ";\n";
+	}
+
+	// A continuous stream of events still returns after one batch.
+	std::atomic<bool> writing(true);
+	std::thread writer([&]() {
+		while (writing) {
+			write_file(user_dir + "/stream.ini");
+		}
+	});
+	const auto start = std::chrono::steady_clock::now();
+	changes.clear();
+	watcher.read_changes(changes, 1000, 20);
+	const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	writing = false;
+	writer.join();
+	while (watcher.read_changes(changes)) {
+	}
+	cout << (!changes.empty() && elapsed_ms < 500 ? "PASS! " : (error_count++, "FAIL! ")) << "bounded read_changes; elapsed_ms = " << elapsed_ms << ";\n";
+
+	// More events than the inotify queue holds are reported as a rescan.
+	for (int n = 0; n < 20000; n++) {
+		write_file(user_dir + (n % 2 ? "/a.ini" : "/b.ini"));
+	}
+	bool rescan = false;
+	changes.clear();
+	while (watcher.read_changes(changes)) {
+		for (const ConfigChange& change : changes) {
+			rescan = rescan || (change.level == ConfigChange::rescan && change.name.empty() && (change.events & IN_Q_OVERFLOW));
+		}
+		changes.clear();
+	}
+	cout << (rescan ? "PASS! " : (error_count++, "FAIL! ")) << "queue overflow reported;\n";
+
+	// A missing directory is watched once it appears, through its closest existing parent.
+	const _CXTSTR missing_dir = root + "/missing" AppDirsCPP_cat;
+	mkdir((root + "/missing").c_str(), 0700);
+	mkdir(missing_dir.c_str(), 0700);
+	bool appeared = wait_change(watcher, 1, "", IN_CREATE);
+	write_file(missing_dir + "/late.ini");
+	appeared = appeared && wait_change(watcher, 1, "late.ini", IN_CLOSE_WRITE);
+	cout << (appeared ? "PASS! " : (error_count++, "FAIL! ")) << "missing directory appears;\n";
+
+	// A removed directory is reported, then watched again once recreated.
+	unlink((site_dir + "/renamed.ini").c_str());
+	rmdir(site_dir.c_str());
+	bool rewatched = wait_change(watcher, 2, "", IN_IGNORED);
+	mkdir(site_dir.c_str(), 0700);
+	rewatched = rewatched && wait_change(watcher, 2, "", IN_CREATE);
+	write_file(site_dir + "/again.ini");
+	rewatched = rewatched && wait_change(watcher, 2, "again.ini", IN_CLOSE_WRITE);
+	cout << (rewatched ? "PASS! " : (error_count++, "FAIL! ")) << "removed directory watched again;\n";
+
+	const _CXTSTR remove_root = "rm -rf " + root;
+	if (system(remove_root.c_str()) != 0) {
+		cout << "WARNING: unable to remove " << root << "\n";
+	}
+#endif
+	return error_count;
+}
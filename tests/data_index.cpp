@@ -0,0 +1,64 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static void touch(const _CXTSTR& path)
+{
+	close(open(path.c_str(), O_WRONLY | O_CREAT, 0600));
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if !defined(__linux__)
+	cout << "SKIP! DataIndex is only available on Linux.\n";
+#else
+	char root_template[] = "/tmp/AppDirsCPP_index_XXXXXX";
+	const _CXTSTR root = mkdtemp(root_template);
+	setenv("XDG_DATA_HOME", (root + "/user").c_str(), 1);
+	setenv("XDG_DATA_DIRS", (root + "/site1:" + root + "/missing:" + root + "/site2").c_str(), 1);
+	const _CXTSTR plugins = _CXT("plugins");
+	const _CXTSTR user_dir = ensure_user_data_dir(&AppDirsCPP_cstr) + "/plugins";
+	const _CXTSTR site1_dir = root + "/site1" AppDirsCPP_cat "/plugins";
+	const _CXTSTR site2_dir = root + "/site2" AppDirsCPP_cat "/plugins";
+	for (const _CXTSTR& dir : { root + "/site1", root + "/site1" AppDirsCPP_cat, site1_dir, root + "/site2", root + "/site2" AppDirsCPP_cat, site2_dir, user_dir }) {
+		mkdir(dir.c_str(), 0700);
+	}
+	touch(user_dir + "/a.so");
+	touch(site1_dir + "/a.so");
+	touch(site1_dir + "/b.so");
+	touch(site2_dir + "/b.so");
+	touch(site2_dir + "/c.so");
+
+	DataIndex index;
+	const int error = index.build(&AppDirsCPP_cstr, nullptr, nullptr, &plugins);
+	error_count += expect("build", !error && index.directories().size() == 4 && index.entries().size() == 3 && index.generation() == 1);
+	error_count += expect("user shadows site", index.find("a.so") && index.find("a.so") == user_dir + "/a.so" && index.entries().at("a.so").level == 0);
+	error_count += expect("site order", index.find("b.so") && index.find("b.so") == site1_dir + "/b.so" && index.entries().at("b.so").level == 1);
+	error_count += expect("site only", index.find("c.so") && index.find("c.so") == site2_dir + "/c.so" && index.entries().at("c.so").level == 3);
+	error_count += expect("missing name", !index.find("d.so"));
+
+	// Nothing changed, so the generation stays.
+	error_count += expect("refresh unchanged", !index.refresh() && index.generation() == 1);
+
+	// Removing the user copy uncovers the site copy.
+	unlink((user_dir + "/a.so").c_str());
+	touch(site2_dir + "/d.so");
+	error_count += expect("refresh changed", !index.refresh() && index.generation() == 2);
+	error_count += expect("site uncovered", index.find("a.so") && index.find("a.so") == site1_dir + "/a.so");
+	error_count += expect("site added", index.find("d.so") && index.find("d.so") == site2_dir + "/d.so");
+#endif
+	return error_count;
+}
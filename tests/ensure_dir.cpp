@@ -0,0 +1,77 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int expect_dir(const char* name, const _CXTSTR& result, const _CXTSTR& expected, const int error)
+{
+	struct stat st;
+	const bool pass = !error && result == expected && stat(result.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && (st.st_mode & 0777) == 0700;
+	cout << (pass ? "PASS! " : "FAIL! ") << name << "; full_path = " << result << "; error = " << error << ";\n";
+	return pass ? 0 : 1;
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if defined(_WIN32)
+	cout << "SKIP! ensure_user_*_dir are not available on Windows.\n";
+#else
+	char root_template[] = "/tmp/AppDirsCPP_ensure_XXXXXX";
+	const _CXTSTR root = mkdtemp(root_template);
+	setenv("XDG_DATA_HOME", (root + "/data").c_str(), 1);
+	setenv("XDG_CONFIG_HOME", (root + "/config/nested").c_str(), 1);
+	setenv("XDG_CACHE_HOME", (root + "/cache//deeply/nested/").c_str(), 1);
+	setenv("XDG_STATE_HOME", (root + "/state").c_str(), 1);
+
+	// Call twice, second call is served by the list of ensured directories.
+	for (int pass = 0; pass < 2; pass++) {
+		int error = 0;
+		error_count += expect_dir("ensure_user_data_dir", ensure_user_data_dir(&AppDirsCPP_cstr, nullptr, &version_cstr, false, &error), root + "/data" AppDirsCPP_cat version_cat, error);
+		error_count += expect_dir("ensure_user_config_dir", ensure_user_config_dir(&AppDirsCPP_cstr, nullptr, nullptr, false, &error), root + "/config/nested" AppDirsCPP_cat, error);
+		error_count += expect_dir("ensure_user_cache_dir", ensure_user_cache_dir(&AppDirsCPP_cstr, nullptr, nullptr, true, &error), root + "/cache//deeply/nested/" AppDirsCPP_cat, error);
+		error_count += expect_dir("ensure_user_state_dir", ensure_user_state_dir(&AppDirsCPP_cstr, nullptr, nullptr, false, &error), root + "/state" AppDirsCPP_cat, error);
+		error_count += expect_dir("ensure_user_log_dir", ensure_user_log_dir(&AppDirsCPP_cstr, nullptr, nullptr, true, &error), root + "/cache//deeply/nested/" AppDirsCPP_cat log_cat, error);
+	}
+
+	// A remembered directory removed since is created again.
+	int error = 0;
+	const _CXTSTR state_dir = root + "/state" AppDirsCPP_cat;
+	rmdir(state_dir.c_str());
+	error_count += expect_dir("ensure_user_state_dir(removed)", ensure_user_state_dir(&AppDirsCPP_cstr, nullptr, nullptr, false, &error), state_dir, error);
+
+	// A file in the way is reported as an error.
+	setenv("XDG_STATE_HOME", (root + "/data" AppDirsCPP_cat version_cat).c_str(), 1);
+	const _CXTSTR file_path = root + "/data" AppDirsCPP_cat version_cat AppDirsCPP_cat;
+	FILE* file = fopen(file_path.c_str(), "w");
+	fclose(file);
+	const _CXTSTR& blocked = ensure_user_state_dir(&AppDirsCPP_cstr, nullptr, nullptr, false, &error);
+	if (blocked.empty() && error == ENOTDIR) {
+		cout << "PASS! ensure_user_state_dir(file); error = " << error << ";\n";
+	}
+	else {
+		cout << "FAIL! ensure_user_state_dir(file); full_path = " << blocked << "; error = " << error << ";\n";
+		error_count++;
+	}
+
+	unsetenv("XDG_DATA_HOME");
+	unsetenv("XDG_CONFIG_HOME");
+	unsetenv("XDG_CACHE_HOME");
+	unsetenv("XDG_STATE_HOME");
+	const _CXTSTR remove_root = "rm -rf " + root;
+	if (system(remove_root.c_str()) != 0) {
+		cout << "WARNING: unable to remove " << root << "\n";
+	}
+#endif
+	return error_count;
+}
@@ -0,0 +1,92 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+#include "internal.hpp"
+
+#if !defined(_WIN32)
+struct tenant {
+	std::map<std::string, std::string> variables;
+	std::string home;
+	std::string user_data;
+	std::string user_cache;
+};
+
+static bool check_tenant(const tenant& t)
+{
+	const AppDirsEnv environment(t.variables);
+	int error = 0;
+	if (user_data_dir(environment, &AppDirsCPP_cstr, nullptr, nullptr, false, &error) != t.user_data || error) {
+		return false;
+	}
+	if (user_cache_dir(environment, &AppDirsCPP_cstr, nullptr, nullptr, false, &error) != t.user_cache || error) {
+		return false;
+	}
+	const AppDirs dirs = resolve_all(environment, &AppDirsCPP_cstr, nullptr, nullptr, AppDirsOptions(), &error);
+	return !error && dirs.str(AppDirs::user_data) == t.user_data && dirs.str(AppDirs::user_config) == user_config_dir(environment, &AppDirsCPP_cstr) && dirs.str(AppDirs::site_data) == site_data_dir(environment, &AppDirsCPP_cstr)[0];
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if !defined(_WIN32)
+	tenant tenants[4];
+	for (int i = 0; i < 4; i++) {
+		tenant& t = tenants[i];
+		t.home = "/home/tenant" + std::to_string(i);
+		t.variables["HOME"] = t.home;
+#if defined(__APPLE__)
+		t.user_data = t.home + "/Library/Application Support" AppDirsCPP_cat;
+		t.user_cache = t.home + "/Library/Caches" AppDirsCPP_cat;
+#else
+		if (i % 2) {
+			t.variables["XDG_DATA_HOME"] = "/srv/tenant" + std::to_string(i) + "/data";
+			t.variables["XDG_CACHE_HOME"] = "/srv/tenant" + std::to_string(i) + "/cache";
+			t.user_data = t.variables["XDG_DATA_HOME"] + AppDirsCPP_cat;
+			t.user_cache = t.variables["XDG_CACHE_HOME"] + AppDirsCPP_cat;
+		}
+		else {
+			t.user_data = t.home + "/.local/share" AppDirsCPP_cat;
+			t.user_cache = t.home + "/.cache" AppDirsCPP_cat;
+		}
+#endif
+	}
+
+	// Each tenant resolved from its own thread, without touching the process environment.
+	const _CXTSTR process_data = user_data_dir(&AppDirsCPP_cstr);
+	std::atomic<int> failures(0);
+	std::thread threads[4];
+	for (int i = 0; i < 4; i++) {
+		threads[i] = std::thread([&, i]() {
+			for (int n = 0; n < 100; n++) {
+				if (!check_tenant(tenants[i])) {
+					failures++;
+					return;
+				}
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	for (int i = 0; i < 4; i++) {
+		cout << (check_tenant(tenants[i]) ? "PASS! " : (error_count++, "FAIL! ")) << "tenant[" << i << "]; user_data_dir = " << tenants[i].user_data << ";\n";
+	}
+	cout << (failures ? (error_count++, "FAIL! ") : "PASS! ") << "concurrent tenants; failures = " << failures << ";\n";
+	cout << (user_data_dir(&AppDirsCPP_cstr) == process_data ? "PASS! " : (error_count++, "FAIL! ")) << "process environment unchanged; user_data_dir = " << process_data << ";\n";
+
+	// Explicit home overrides $HOME of the environment.
+	std::map<std::string, std::string> variables;
+	const AppDirsEnv explicit_home(variables, "/home/explicit");
+	const _CXTSTR home_data = user_data_dir(explicit_home);
+	cout << (home_data.compare(0, 15, "/home/explicit/") == 0 ? "PASS! " : (error_count++, "FAIL! ")) << "explicit home; user_data_dir = " << home_data << ";\n";
+#endif
+	return error_count;
+}
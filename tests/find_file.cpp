@@ -0,0 +1,93 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void make_file(const _CXTSTR& dir, const _CXTSTR& file)
+{
+	mkdir(dir.c_str(), 0700);
+	mkdir((dir + AppDirsCPP_cat).c_str(), 0700);
+	close(open((dir + AppDirsCPP_cat "/" + file).c_str(), O_CREAT | O_WRONLY, 0600));
+}
+
+static int expect_equal(const char* name, const _CXTSTR& result, const _CXTSTR& expected)
+{
+	cout << (result == expected ? "PASS! " : "FAIL! ") << name << "; full_path = " << result << ";\n";
+	return result == expected ? 0 : 1;
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if defined(_WIN32)
+	cout << "SKIP! find_data_file is not available on Windows.\n";
+#else
+	char root_template[] = "/tmp/AppDirsCPP_find_XXXXXX";
+	const _CXTSTR root = mkdtemp(root_template);
+	const _CXTSTR user = root + "/user";
+	const _CXTSTR site1 = root + "/site1";
+	const _CXTSTR site2 = root + "/site2";
+	make_file(user, "user.txt");
+	make_file(site1, "both.txt");
+	make_file(site2, "both.txt");
+	make_file(site2, "site2.txt");
+
+	setenv("XDG_DATA_HOME", user.c_str(), 1);
+	setenv("XDG_DATA_DIRS", (site1 + pathsep + site2).c_str(), 1);
+	setenv("XDG_CONFIG_HOME", user.c_str(), 1);
+	setenv("XDG_CONFIG_DIRS", (site1 + pathsep + site2).c_str(), 1);
+
+	int error = 0;
+	error_count += expect_equal("find_data_file(user)", find_data_file("user.txt", &AppDirsCPP_cstr), user + AppDirsCPP_cat "/user.txt");
+	error_count += expect_equal("find_data_file(both)", find_data_file("both.txt", &AppDirsCPP_cstr), site1 + AppDirsCPP_cat "/both.txt");
+	error_count += expect_equal("find_config_file(site2)", find_config_file("site2.txt", &AppDirsCPP_cstr), site2 + AppDirsCPP_cat "/site2.txt");
+
+	error_count += expect_equal("find_data_file(missing)", find_data_file("missing.txt", &AppDirsCPP_cstr, nullptr, nullptr, nullptr, &error), "");
+	if (error != ENOENT) {
+		cout << "FAIL! find_data_file(missing); return " << error << "!\n";
+		error_count++;
+	}
+
+	// A directory in the user dir does not hide the file of a site dir.
+	mkdir((user + AppDirsCPP_cat "/both.txt").c_str(), 0700);
+	error_count += expect_equal("find_data_file(shadow dir)", find_data_file("both.txt", &AppDirsCPP_cstr), site1 + AppDirsCPP_cat "/both.txt");
+	int fd = -1;
+	error_count += expect_equal("find_config_file(shadow dir, fd)", find_config_file("both.txt", &AppDirsCPP_cstr, nullptr, nullptr, &fd), site1 + AppDirsCPP_cat "/both.txt");
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+		cout << "FAIL! find_config_file(shadow dir, fd); fd = " << fd << ";\n";
+		error_count++;
+	}
+	close(fd);
+
+	fd = -1;
+	error_count += expect_equal("find_data_file(fd)", find_data_file("site2.txt", &AppDirsCPP_cstr, nullptr, nullptr, &fd), site2 + AppDirsCPP_cat "/site2.txt");
+	if (fd < 0) {
+		cout << "FAIL! find_data_file(fd); fd = " << fd << ";\n";
+		error_count++;
+	}
+	close(fd);
+
+	unsetenv("XDG_DATA_HOME");
+	unsetenv("XDG_DATA_DIRS");
+	unsetenv("XDG_CONFIG_HOME");
+	unsetenv("XDG_CONFIG_DIRS");
+	const _CXTSTR remove_root = "rm -rf " + root;
+	if (system(remove_root.c_str()) != 0) {
+		cout << "WARNING: unable to remove " << root << "\n";
+	}
+#endif
+	return error_count;
+}
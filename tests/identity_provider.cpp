@@ -0,0 +1,169 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <cerrno>
+#include <iostream>
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "internal.hpp"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+
+// Fake provider answering after a delay.
+struct fake_provider {
+	std::string home;
+	int delay_ms;
+	int rc = 0;
+	std::atomic<int> calls;
+};
+
+static int fake_lookup(uid_t, std::string& home, void* context)
+{
+	fake_provider& fake = *static_cast<fake_provider*>(context);
+	fake.calls++;
+	std::this_thread::sleep_for(std::chrono::milliseconds(fake.delay_ms));
+	home = fake.home;
+	return fake.rc;
+}
+
+static long long elapsed_ms(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int expect(const char* name, const bool pass, const _CXTSTR& detail)
+{
+	cout << (pass ? "PASS! " : "FAIL! ") << name << "; " << detail << ";\n";
+	return pass ? 0 : 1;
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if defined(_WIN32)
+	cout << "SKIP! Identity providers are not used on Windows.\n";
+#else
+	unsetenv("HOME");
+	unsetenv("XDG_CONFIG_HOME");
+#if defined(__APPLE__)
+	const _CXTSTR config_tail = "/Library/Preferences" AppDirsCPP_cat;
+#else
+	const _CXTSTR config_tail = "/.config" AppDirsCPP_cat;
+#endif
+
+	// A stalled provider is bounded by the timeout, and its late result is used afterwards.
+	fake_provider slow;
+	slow.home = "/home/slow";
+	slow.delay_ms = 300;
+	slow.calls = 0;
+	AppDirsIdentityOptions options;
+	options.provider = AppDirsHomeProvider(fake_lookup, &slow);
+	options.timeout_ms = 50;
+	options.fallback = "/fallback";
+	appdirs_set_identity(options);
+	auto start = std::chrono::steady_clock::now();
+	_CXTSTR path = user_config_dir(&AppDirsCPP_cstr);
+	long long ms = elapsed_ms(start);
+	error_count += expect("timeout falls back", path == "/fallback" + config_tail && ms < 250, path + "; " + std::to_string(ms) + " ms");
+	std::this_thread::sleep_for(std::chrono::milliseconds(400));
+	path = user_config_dir(&AppDirsCPP_cstr);
+	error_count += expect("late result kept", path == "/home/slow" + config_tail && slow.calls == 1, path);
+
+	// Prefetch overlaps the lookup with startup.
+	fake_provider prefetched;
+	prefetched.home = "/home/prefetched";
+	prefetched.delay_ms = 100;
+	prefetched.calls = 0;
+	options.provider = AppDirsHomeProvider(fake_lookup, &prefetched);
+	options.timeout_ms = 1000;
+	options.prefetch = true;
+	appdirs_set_identity(options);
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	start = std::chrono::steady_clock::now();
+	path = user_config_dir(&AppDirsCPP_cstr);
+	ms = elapsed_ms(start);
+	error_count += expect("prefetch", path == "/home/prefetched" + config_tail && prefetched.calls == 1 && ms < 50, path + "; " + std::to_string(ms) + " ms");
+
+	// Concurrent callers share one lookup.
+	prefetched.calls = 0;
+	options.prefetch = false;
+	appdirs_set_identity(options);
+	std::thread threads[8];
+	std::atomic<int> mismatches(0);
+	for (auto& thread : threads) {
+		thread = std::thread([&]() {
+			if (user_config_dir(&AppDirsCPP_cstr) != "/home/prefetched" + config_tail) {
+				mismatches++;
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	error_count += expect("shared lookup", prefetched.calls == 1 && mismatches == 0, "calls = " + std::to_string(prefetched.calls));
+
+	// A failure is remembered for retry_ms, then the provider is queried again.
+	fake_provider failing;
+	failing.delay_ms = 0;
+	failing.rc = ENOENT;
+	failing.calls = 0;
+	options.provider = AppDirsHomeProvider(fake_lookup, &failing);
+	options.timeout_ms = 0;
+	options.retry_ms = 100;
+	appdirs_set_identity(options);
+	for (int i = 0; i < 5; i++) {
+		path = user_config_dir(&AppDirsCPP_cstr);
+	}
+	error_count += expect("failure remembered", path == "/fallback" + config_tail && failing.calls == 1, "calls = " + std::to_string(failing.calls));
+	std::this_thread::sleep_for(std::chrono::milliseconds(150));
+	user_config_dir(&AppDirsCPP_cstr);
+	error_count += expect("failure retried", failing.calls == 2, "calls = " + std::to_string(failing.calls));
+
+	// A stalled provider runs once per uid, however many callers time out on it.
+	fake_provider stalled;
+	stalled.home = "/home/stalled";
+	stalled.delay_ms = 300;
+	stalled.calls = 0;
+	options.provider = AppDirsHomeProvider(fake_lookup, &stalled);
+	options.timeout_ms = 10;
+	appdirs_set_identity(options);
+	for (int i = 0; i < 10; i++) {
+		path = user_config_dir(&AppDirsCPP_cstr);
+	}
+	error_count += expect("single stalled lookup", path == "/fallback" + config_tail && stalled.calls == 1, "calls = " + std::to_string(stalled.calls));
+	std::this_thread::sleep_for(std::chrono::milliseconds(400));
+
+		// passwd file provider.
+	char file_template[] = "/tmp/AppDirsCPP_passwd_XXXXXX";
+	close(mkstemp(file_template));
+	std::ofstream(file_template) << "huge:x:99999999999999999999:0::/home/huge:/bin/sh\nbroken\nother:x:" << getuid() + 1 << ":0::/home/other:/bin/sh\nme:x:" << getuid() << ":0:Me:/home/from-file:/bin/sh\n";
+	options = AppDirsIdentityOptions();
+	options.provider = appdirs_home_provider_passwd_file(file_template);
+	appdirs_set_identity(options);
+	path = user_config_dir(&AppDirsCPP_cstr);
+	error_count += expect("passwd file", path == "/home/from-file" + config_tail, path);
+	unlink(file_template);
+
+	// No provider, only the fallback.
+	options = AppDirsIdentityOptions();
+	options.provider = appdirs_home_provider_none();
+	appdirs_set_identity(options);
+	path = user_config_dir(&AppDirsCPP_cstr);
+	error_count += expect("none", path == "~" + config_tail, path);
+
+	// A new fallback replaces the previous one.
+	options.fallback = "/second";
+	appdirs_set_identity(options);
+	path = user_config_dir(&AppDirsCPP_cstr);
+	error_count += expect("fallback replaced", path == "/second" + config_tail, path);
+#endif
+	return error_count;
+}
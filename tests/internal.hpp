@@ -5,6 +5,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "internal.h"
+#include <iostream>
 
 static const _CXTSTR pathsep_cstr = pathsep;
 
@@ -89,6 +90,13 @@ static inline bool IsWindowsVistaOrGreater()
 
 #include <bitset>
 
+// Print the result of a check, return 1 if it failed.
+static inline int expect(const char* name, const bool pass)
+{
+	cout << (pass ? "PASS! " : "FAIL! ") << name << ";\n";
+	return pass ? 0 : 1;
+}
+
 template<std::size_t N>
 static inline std::bitset<N> reverse_bits(const std::bitset<N> b)
 {
@@ -0,0 +1,80 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "internal.hpp"
+
+static int expect_equal(const char* name, const _CXTSTR& result, const _CXTSTR& expected)
+{
+	if (result == expected) {
+		cout << "PASS! " << name << "; full_path = " << result << ";\n";
+		return 0;
+	}
+	cout << "FAIL! " << name << "; full_path = " << result << "; expected = " << expected << ";\n";
+	return 1;
+}
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+
+	const _CXTSTR& data_uncached = user_data_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr);
+	const _CXTSTR& config_uncached = user_config_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr);
+	const _CXTSTR& cache_uncached = user_cache_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr);
+	const _CXTSTR& state_uncached = user_state_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr);
+	const _CXTSTR& log_uncached = user_log_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr);
+
+	appdirs_set_cached(true);
+
+	// Cached mode must resolve to the same paths as uncached mode.
+	for (int pass = 0; pass < 2; pass++) {
+		error_count += expect_equal("user_data_dir", user_data_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr), data_uncached);
+		error_count += expect_equal("user_config_dir", user_config_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr), config_uncached);
+		error_count += expect_equal("user_cache_dir", user_cache_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr), cache_uncached);
+		error_count += expect_equal("user_state_dir", user_state_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr), state_uncached);
+		error_count += expect_equal("user_log_dir", user_log_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr), log_uncached);
+	}
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+	// Environment changes are only seen after appdirs_refresh.
+	const _CXTSTR& cache_snapshot = user_cache_dir(&AppDirsCPP_cstr);
+	setenv("XDG_CACHE_HOME", "/tmp/AppDirsCPP_cache", 1);
+	error_count += expect_equal("user_cache_dir (stale)", user_cache_dir(&AppDirsCPP_cstr), cache_snapshot);
+	appdirs_refresh();
+	error_count += expect_equal("user_cache_dir (refreshed)", user_cache_dir(&AppDirsCPP_cstr), "/tmp/AppDirsCPP_cache" AppDirsCPP_cat);
+	unsetenv("XDG_CACHE_HOME");
+	appdirs_refresh();
+#endif
+
+	// Readers keep resolving while the snapshot is replaced.
+	std::atomic<bool> stop(false);
+	std::atomic<int> mismatch_count(0);
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; i++) {
+		readers.emplace_back([&]() {
+			while (!stop.load()) {
+				if (user_cache_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr) != cache_uncached) {
+					mismatch_count++;
+				}
+			}
+		});
+	}
+	for (int i = 0; i < 1000; i++) {
+		appdirs_refresh();
+	}
+	stop.store(true);
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	cout << (mismatch_count ? "FAIL! " : "PASS! ") << "user_cache_dir (concurrent refresh); mismatch = " << mismatch_count << ";\n";
+	error_count += mismatch_count ? 1 : 0;
+
+	appdirs_set_cached(false);
+	return error_count;
+}
@@ -0,0 +1,123 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "internal.hpp"
+
+#if defined(__linux__)
+#include <sys/stat.h>
+
+static std::string read_file(const std::string& path)
+{
+	std::ifstream file(path);
+	std::stringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if !defined(__linux__)
+	cout << "SKIP! LogWriter is only available on Linux.\n";
+#else
+	char root_template[] = "/tmp/AppDirsCPP_log_XXXXXX";
+	const _CXTSTR root = mkdtemp(root_template);
+	setenv("XDG_CACHE_HOME", root.c_str(), 1);
+
+	// Several threads, with rings small enough to fill up.
+	LogWriter writer;
+	int error = writer.open(&AppDirsCPP_cstr, nullptr, nullptr, "app.log", 0, 5, 256, 5);
+	error_count += expect("open", !error && writer.directory() == user_log_dir(&AppDirsCPP_cstr));
+	std::thread threads[4];
+	for (int t = 0; t < 4; t++) {
+		threads[t] = std::thread([&writer, t]() {
+			for (int n = 0; n < 1000; n++) {
+				const std::string line = "thread " + std::to_string(t) + " line " + std::to_string(n) + "\n";
+				writer.write(line.data(), line.size());
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	writer.flush();
+	const std::string content = read_file(writer.directory() + "/app.log");
+
+	// Every line is present once, in order within its thread.
+	bool ordered = true;
+	size_t lines = 0;
+	int next[4] = {};
+	std::istringstream stream(content);
+	std::string line;
+	while (std::getline(stream, line)) {
+		int t = -1, n = -1;
+		if (sscanf(line.c_str(), "thread %d line %d", &t, &n) != 2 || t < 0 || t >= 4 || next[t] != n) {
+			ordered = false;
+			break;
+		}
+		next[t]++;
+		lines++;
+	}
+	error_count += expect("all lines in order", ordered && lines == 4000 && !writer.error());
+
+	// Rings of exited threads are freed once drained.
+	for (int t = 0; t < 50; t++) {
+		std::thread([&writer]() { writer.write("short-lived\n", 12); }).join();
+	}
+	for (int attempt = 0; attempt < 200 && writer.buffers(); attempt++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	error_count += expect("rings of exited threads freed", writer.buffers() == 0);
+	writer.close();
+
+	// close waits for writes in progress, and later writes fail.
+	error = writer.open(&AppDirsCPP_cstr, nullptr, nullptr, "race.log", 0, 5, 256, 5);
+	std::atomic<bool> closed(false);
+	std::atomic<int> late_writes(0);
+	for (int t = 0; t < 4; t++) {
+		threads[t] = std::thread([&]() {
+			while (!closed) {
+				writer.write("racing\n", 7);
+			}
+			late_writes += writer.write("late\n", 5);
+		});
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	writer.close();
+	closed = true;
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	error_count += expect("close racing write", !error && late_writes == 0);
+
+	// Rotation keeps max_files files of at most max_file_bytes each.
+	error = writer.open(&AppDirsCPP_cstr, nullptr, nullptr, "rotate.log", 100, 3, 4096, 1);
+	const std::string record(40, 'r');
+	for (int n = 0; n < 20; n++) {
+		writer.write((record.substr(1) + "\n").data(), record.size());
+		writer.flush();
+	}
+	const std::string directory = writer.directory();
+	writer.close();
+	struct stat st;
+	bool rotated = !error;
+	for (const char* name : { "/rotate.log", "/rotate.log.1", "/rotate.log.2" }) {
+		rotated = rotated && stat((directory + name).c_str(), &st) == 0 && st.st_size <= 100;
+	}
+	rotated = rotated && stat((directory + "/rotate.log.3").c_str(), &st) != 0;
+	error_count += expect("rotation", rotated);
+	error_count += expect("closed", !writer.write("x\n", 2));
+#endif
+	return error_count;
+}
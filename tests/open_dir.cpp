@@ -0,0 +1,105 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static int expect_handle(const char* name, const int fd, const int again, const int error)
+{
+	struct stat st;
+	const bool pass = fd >= 0 && fd == again && !error && fstatat(fd, "key", &st, 0) == 0;
+	cout << (pass ? "PASS! " : "FAIL! ") << name << "; fd = " << fd << "; error = " << error << ";\n";
+	return pass ? 0 : 1;
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if defined(_WIN32)
+	cout << "SKIP! open_*_dir are not available on Windows.\n";
+#else
+	char root_template[] = "/tmp/AppDirsCPP_open_XXXXXX";
+	const _CXTSTR root = mkdtemp(root_template);
+	setenv("XDG_DATA_HOME", (root + "/data").c_str(), 1);
+	setenv("XDG_CONFIG_HOME", (root + "/config").c_str(), 1);
+	setenv("XDG_CACHE_HOME", (root + "/cache").c_str(), 1);
+	setenv("XDG_STATE_HOME", (root + "/state").c_str(), 1);
+	setenv("XDG_DATA_DIRS", (root + "/missing:" + root + "/site").c_str(), 1);
+	setenv("XDG_CONFIG_DIRS", (root + "/site").c_str(), 1);
+
+	// Create each directory with a file inside, to be found relative to the handle.
+	const _CXTSTR dirs[] = {
+		ensure_user_data_dir(&AppDirsCPP_cstr),
+		ensure_user_config_dir(&AppDirsCPP_cstr),
+		ensure_user_cache_dir(&AppDirsCPP_cstr),
+		ensure_user_state_dir(&AppDirsCPP_cstr),
+		ensure_user_log_dir(&AppDirsCPP_cstr),
+	};
+	mkdir((root + "/site").c_str(), 0700);
+	mkdir((root + "/site" AppDirsCPP_cat).c_str(), 0700);
+	for (const _CXTSTR& dir : dirs) {
+		close(open((dir + "/key").c_str(), O_WRONLY | O_CREAT, 0600));
+	}
+	close(open((root + "/site" AppDirsCPP_cat "/key").c_str(), O_WRONLY | O_CREAT, 0600));
+
+	int error = 0;
+	int fd = open_user_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, false, &error);
+	error_count += expect_handle("open_user_data_dir", fd, open_user_data_dir(&AppDirsCPP_cstr), error);
+	fd = open_site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, &error);
+	error_count += expect_handle("open_site_data_dir", fd, open_site_data_dir(&AppDirsCPP_cstr), error);
+	fd = open_user_config_dir(&AppDirsCPP_cstr, nullptr, nullptr, false, &error);
+	error_count += expect_handle("open_user_config_dir", fd, open_user_config_dir(&AppDirsCPP_cstr), error);
+	fd = open_site_config_dir(&AppDirsCPP_cstr, nullptr, nullptr, &error);
+	error_count += expect_handle("open_site_config_dir", fd, open_site_config_dir(&AppDirsCPP_cstr), error);
+	fd = open_user_cache_dir(&AppDirsCPP_cstr, nullptr, nullptr, true, &error);
+	error_count += expect_handle("open_user_cache_dir", fd, open_user_cache_dir(&AppDirsCPP_cstr), error);
+	fd = open_user_state_dir(&AppDirsCPP_cstr, nullptr, nullptr, false, &error);
+	error_count += expect_handle("open_user_state_dir", fd, open_user_state_dir(&AppDirsCPP_cstr), error);
+	fd = open_user_log_dir(&AppDirsCPP_cstr, nullptr, nullptr, true, &error);
+	error_count += expect_handle("open_user_log_dir", fd, open_user_log_dir(&AppDirsCPP_cstr), error);
+
+	// A replaced directory is opened again onto the same handle, instead of returning the stale one.
+	const int old_fd = open_user_data_dir(&AppDirsCPP_cstr);
+	rename(dirs[0].c_str(), (dirs[0] + ".old").c_str());
+	mkdir(dirs[0].c_str(), 0700);
+	close(open((dirs[0] + "/key").c_str(), O_WRONLY | O_CREAT, 0600));
+	fd = open_user_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, false, &error);
+	struct stat new_st, path_st;
+	const bool replaced = fd == old_fd && !fstat(fd, &new_st) && !stat(dirs[0].c_str(), &path_st) && new_st.st_ino == path_st.st_ino;
+	error_count += expect_handle("open_user_data_dir(replaced)", replaced ? fd : -1, open_user_data_dir(&AppDirsCPP_cstr), error);
+
+	// Replacing the directory again and again does not leak descriptors.
+	const int probe = open("/dev/null", O_RDONLY);
+	close(probe);
+	int replaced_count = 0;
+	for (int i = 0; i < 20; i++) {
+		rename(dirs[0].c_str(), (dirs[0] + ".old" + std::to_string(i)).c_str());
+		mkdir(dirs[0].c_str(), 0700);
+		replaced_count += open_user_data_dir(&AppDirsCPP_cstr) == old_fd;
+	}
+	const int probe_after = open("/dev/null", O_RDONLY);
+	close(probe_after);
+	error_count += expect("open_user_data_dir(no leak)", probe_after == probe && replaced_count == 20);
+
+	// Missing directory is reported as an error.
+	fd = open_user_data_dir(&version_cstr, nullptr, nullptr, false, &error);
+	if (fd == -1 && error == ENOENT) {
+		cout << "PASS! open_user_data_dir(missing); error = " << error << ";\n";
+	}
+	else {
+		cout << "FAIL! open_user_data_dir(missing); fd = " << fd << "; error = " << error << ";\n";
+		error_count++;
+	}
+#endif
+	return error_count;
+}
@@ -0,0 +1,125 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <new>
+
+#include "internal.hpp"
+
+// Count every heap allocation made through operator new.
+static size_t allocation_count = 0;
+
+void* operator new(size_t size)
+{
+	allocation_count++;
+	void* ptr = std::malloc(size ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+typedef _CXTSTR (*user_dir_func)(const _CXTSTR*, const _CXTSTR*, const _CXTSTR*, const bool, int*);
+typedef size_t (*user_dir_append_func)(const _CXTSTR*, const _CXTSTR*, const _CXTSTR*, const bool, _CXTSTR&, int*);
+typedef size_t (*user_dir_buffer_func)(const _CXTSTR*, const _CXTSTR*, const _CXTSTR*, const bool, _CXTCHAR*, const size_t, int*);
+typedef std::vector<_CXTSTR> (*site_dir_func)(const _CXTSTR*, const _CXTSTR*, const _CXTSTR*, const bool, int*);
+
+struct test_case {
+	const char* name;
+	user_dir_func user_dir;
+	site_dir_func site_dir;
+	user_dir_append_func append_dir;
+	user_dir_buffer_func buffer_dir;
+};
+
+static const std::array<test_case, 7> test_cases = { {
+	{ "user_data_dir", user_data_dir, nullptr, user_data_dir, user_data_dir },
+	{ "site_data_dir", nullptr, site_data_dir, site_data_dir, site_data_dir },
+	{ "user_config_dir", user_config_dir, nullptr, user_config_dir, user_config_dir },
+	{ "site_config_dir", nullptr, site_config_dir, site_config_dir, site_config_dir },
+	{ "user_cache_dir", user_cache_dir, nullptr, user_cache_dir, user_cache_dir },
+	{ "user_state_dir", user_state_dir, nullptr, user_state_dir, user_state_dir },
+	{ "user_log_dir", user_log_dir, nullptr, user_log_dir, user_log_dir },
+} };
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+	_CXTCHAR buffer[4096];
+	_CXTCHAR small_buffer[4];
+	_CXTSTR append_path;
+
+	for (int cached = 0; cached < 2; cached++) {
+		appdirs_set_cached(cached != 0);
+		for (const test_case& test : test_cases) {
+			unsigned i = 0;
+			std::bitset<4> param_test = i;
+			const auto param_combo_total = static_cast<unsigned>(std::pow(2, param_test.size()));
+			while (i < param_combo_total) {
+				int error = 0;
+				const _CXTSTR* appname = param_test[0] ? &AppDirsCPP_cstr : NULL;
+				const _CXTSTR* appauthor = param_test[1] ? &AppAuthor_cstr : NULL;
+				const _CXTSTR* version = param_test[2] ? &version_cstr : NULL;
+				bool option = param_test[3] ? true : false;
+
+				_CXTSTR expected;
+				if (test.user_dir) {
+					expected = test.user_dir(appname, appauthor, version, option, &error);
+				}
+				else {
+					for (const auto& full_path : test.site_dir(appname, appauthor, version, option, &error)) {
+						if (!expected.empty()) {
+							expected += pathsep;
+						}
+						expected += full_path;
+					}
+				}
+
+				append_path.reserve(sizeof(buffer) / sizeof(buffer[0]));
+				append_path.clear();
+
+				const size_t allocations = allocation_count;
+				const size_t buffer_length = test.buffer_dir(appname, appauthor, version, option, buffer, sizeof(buffer) / sizeof(buffer[0]), &error);
+				const size_t append_length = test.append_dir(appname, appauthor, version, option, append_path, &error);
+				const size_t small_length = test.buffer_dir(appname, appauthor, version, option, small_buffer, sizeof(small_buffer) / sizeof(small_buffer[0]), &error);
+				const size_t allocated = allocation_count - allocations;
+
+				bool pass = !error && !expected.empty();
+				pass = pass && buffer_length == expected.length() && expected == buffer;
+				pass = pass && append_length == expected.length() && expected == append_path;
+				pass = pass && small_length == expected.length() && expected.compare(0, 3, small_buffer) == 0 && std::char_traits<_CXTCHAR>::length(small_buffer) == std::min<size_t>(3, expected.length());
+#if !defined(_WIN32) // Windows shell API allocates the base directory.
+				pass = pass && allocated == 0;
+#endif
+
+				cout << (pass ? "PASS! " : "FAIL! ") << test.name << (cached ? " (cached)" : "") << "[" << std::setw(2) << i << "]: ";
+				cout << "params[" << reverse_bits(param_test) << "]; allocations = " << allocated << "; full_path = " << buffer << ";\n";
+				if (!pass) {
+					error_count++;
+				}
+
+				param_test = ++i;
+			}
+		}
+	}
+	appdirs_set_cached(false);
+	return error_count;
+}
@@ -0,0 +1,97 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "internal.hpp"
+
+// Count every heap allocation made through operator new.
+static size_t allocation_count = 0;
+
+void* operator new(size_t size)
+{
+	allocation_count++;
+	void* ptr = std::malloc(size ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+static bool same_paths(const PathList& list, const std::vector<_CXTSTR>& full_paths)
+{
+	if (list.size() != full_paths.size() || list.to_vector() != full_paths) {
+		return false;
+	}
+	size_t i = 0;
+	for (const PathList::view entry : list) {
+#if defined(APPDIRS_HAS_STRING_VIEW)
+		const _CXTSTR full_path(entry);
+#else
+		const _CXTSTR full_path(entry.data, entry.length);
+#endif
+		if (full_path != full_paths[i] || list.get(i)[list.length(i)] != 0) {
+			return false;
+		}
+		i++;
+	}
+	return i == full_paths.size();
+}
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if !defined(_WIN32)
+	// Enough entries that a vector of strings would allocate once per entry.
+	setenv("XDG_DATA_DIRS", "/usr/local/share:/usr/share:/opt/a/share:/opt/b/share:/opt/c/share:/opt/d/share:/opt/e/share:/opt/f/share", 1);
+#endif
+
+	PathList paths;
+	int error = -1;
+	size_t count = site_data_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr, true, paths, &error);
+	error_count += expect("site_data_dir multipath", !error && count == paths.size() && same_paths(paths, site_data_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr, true)));
+
+	count = site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, false, paths, &error);
+	error_count += expect("site_data_dir first only", !error && count == 1 && same_paths(paths, site_data_dir(&AppDirsCPP_cstr)));
+
+	count = site_config_dir(&AppDirsCPP_cstr, nullptr, &version_cstr, true, paths, &error);
+	error_count += expect("site_config_dir multipath", !error && count == paths.size() && same_paths(paths, site_config_dir(&AppDirsCPP_cstr, nullptr, &version_cstr, true)));
+
+	count = site_config_dir(AppDirsCPP_str, AppAuthor_str, version_str, false, paths, &error);
+	error_count += expect("site_config_dir literals", !error && count == 1 && same_paths(paths, site_config_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr)));
+
+	paths.clear();
+	error_count += expect("clear", paths.empty() && paths.begin() == paths.end());
+
+#if !defined(_WIN32)
+	// One buffer and one offset table, whatever the number of entries.
+	PathList fresh;
+	size_t before = allocation_count;
+	count = site_data_dir(AppDirsCPP_str, AppAuthor_str, version_str, true, fresh);
+	size_t allocations = allocation_count - before;
+	cout << "entries = " << count << "; allocations = " << allocations << ";\n";
+	error_count += expect("at most two allocations", count == 8 && allocations <= 2);
+
+	// Reused with enough capacity, nothing is allocated.
+	before = allocation_count;
+	count = site_data_dir(AppDirsCPP_str, AppAuthor_str, version_str, true, fresh);
+	allocations = allocation_count - before;
+	error_count += expect("no allocation on reuse", count == 8 && allocations == 0);
+#endif
+	return error_count;
+}
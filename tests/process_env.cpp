@@ -0,0 +1,64 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+static void find_self(pid_t pid, const AppDirs& dirs, void* context)
+{
+	if (pid == getpid()) {
+		*static_cast<_CXTSTR*>(context) = dirs.str(AppDirs::user_cache);
+	}
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if defined(__linux__)
+	// Own process, started with the environment of the test runner.
+	ProcessEnv process;
+	int rc = process.read(getpid());
+	const _CXTSTR own_cache = user_cache_dir(&AppDirsCPP_cstr);
+	cout << (!rc && user_cache_dir(process.environment(), &AppDirsCPP_cstr) == own_cache ? "PASS! " : (error_count++, "FAIL! ")) << "own process; user_cache_dir = " << own_cache << ";\n";
+
+	// Child process with its own overrides.
+	const pid_t child = fork();
+	if (child == 0) {
+		char* const child_argv[] = { const_cast<char*>("sleep"), const_cast<char*>("10"), nullptr };
+		char* const child_envp[] = { const_cast<char*>("HOME=/home/child"), const_cast<char*>("XDG_STATE_HOME=/srv/child/state"), nullptr };
+		execve("/bin/sleep", child_argv, child_envp);
+		_exit(127);
+	}
+	// Wait for exec to replace the environment of the forked copy.
+	for (int attempt = 0; attempt < 100; attempt++) {
+		rc = process.read(child);
+		if (!rc && process.get("XDG_STATE_HOME")) {
+			break;
+		}
+		usleep(10000);
+	}
+	const AppDirsEnv environment = process.environment();
+	const _CXTSTR state = user_state_dir(environment, &AppDirsCPP_cstr);
+	const _CXTSTR log = user_log_dir(environment, &AppDirsCPP_cstr);
+	cout << (!rc && state == "/srv/child/state" AppDirsCPP_cat ? "PASS! " : (error_count++, "FAIL! ")) << "child process; user_state_dir = " << state << ";\n";
+	cout << (!rc && log == "/home/child/.cache" AppDirsCPP_cat "/log" ? "PASS! " : (error_count++, "FAIL! ")) << "child process; user_log_dir = " << log << ";\n";
+	kill(child, SIGKILL);
+	waitpid(child, nullptr, 0);
+
+	// Batch over every process.
+	_CXTSTR batch_cache;
+	rc = resolve_all_processes(find_self, &batch_cache, &AppDirsCPP_cstr);
+	cout << (!rc && batch_cache == own_cache ? "PASS! " : (error_count++, "FAIL! ")) << "resolve_all_processes; user_cache_dir = " << batch_cache << ";\n";
+#endif
+	return error_count;
+}
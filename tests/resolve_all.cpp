@@ -0,0 +1,70 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+
+#include "internal.hpp"
+
+static _CXTSTR join_paths(const std::vector<_CXTSTR>& full_paths)
+{
+	_CXTSTR joined;
+	for (const auto& full_path : full_paths) {
+		if (!joined.empty()) {
+			joined += pathsep;
+		}
+		joined += full_path;
+	}
+	return joined;
+}
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+	unsigned i = 0;
+	std::bitset<4> param_test = i;
+	const auto param_combo_total = static_cast<unsigned>(std::pow(2, param_test.size()));
+
+	while (i < param_combo_total) {
+		int error = 0;
+
+		const _CXTSTR* appname = param_test[0] ? &AppDirsCPP_cstr : NULL;
+		const _CXTSTR* appauthor = param_test[1] ? &AppAuthor_cstr : NULL;
+		const _CXTSTR* version = param_test[2] ? &version_cstr : NULL;
+		AppDirsOptions options;
+		options.roaming = param_test[3] ? true : false;
+		options.multipath = param_test[3] ? true : false;
+		options.opinion = param_test[3] ? true : false;
+		const AppDirs dirs = resolve_all(appname, appauthor, version, options, &error);
+
+		const _CXTSTR expected[AppDirs::dir_count] = {
+			user_data_dir(appname, appauthor, version, options.roaming),
+			join_paths(site_data_dir(appname, appauthor, version, options.multipath)),
+			user_config_dir(appname, appauthor, version, options.roaming),
+			join_paths(site_config_dir(appname, appauthor, version, options.multipath)),
+			user_cache_dir(appname, appauthor, version, options.opinion),
+			user_state_dir(appname, appauthor, version, options.roaming),
+			user_log_dir(appname, appauthor, version, options.opinion),
+		};
+
+		cout << (error ? "ERROR" : "INFO ") << ": resolve_all[" << std::setw(2) << i << "]:\n";
+		for (int id = 0; id < AppDirs::dir_count; id++) {
+			const AppDirs::dir dir_id = static_cast<AppDirs::dir>(id);
+			if (!error && dirs.str(dir_id) == expected[id] && dirs.length(dir_id) == expected[id].length() && expected[id] == dirs.get(dir_id)) {
+				cout << "PASS! ";
+			}
+			else {
+				cout << "FAIL! ";
+				error_count++;
+			}
+			cout << "params[" << reverse_bits(param_test) << "]; full_path[" << id << "] = " << dirs.get(dir_id) << ";\n";
+		}
+
+		param_test = ++i;
+	}
+	return error_count;
+}
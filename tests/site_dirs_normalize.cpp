@@ -0,0 +1,92 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+#include <climits>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static int expect(const char* name, const std::vector<_CXTSTR>& full_paths, const std::vector<_CXTSTR>& expected)
+{
+	const bool pass = full_paths == expected;
+	cout << (pass ? "PASS! " : "FAIL! ") << name << "; site_data_dir =";
+	for (const _CXTSTR& full_path : full_paths) {
+		cout << " " << full_path;
+	}
+	cout << ";\n";
+	return pass ? 0 : 1;
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if defined(_WIN32) || defined(__APPLE__)
+	cout << "SKIP! XDG search paths are only used on *nix.\n";
+#else
+	// Empty, relative, "." components, trailing and repeated slashes, and duplicates.
+	setenv("XDG_DATA_DIRS", ":relative/share:/usr/share/:/opt//app/./share::/usr/share:/opt/app/share/", 1);
+	error_count += expect("normalized", site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true), { "/usr/share" AppDirsCPP_cat, "/opt/app/share" AppDirsCPP_cat });
+
+	// A clean list is used as is.
+	setenv("XDG_DATA_DIRS", "/usr/local/share:/usr/share", 1);
+	error_count += expect("unchanged", site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true), { "/usr/local/share" AppDirsCPP_cat, "/usr/share" AppDirsCPP_cat });
+
+	// No absolute entries falls back to the default, as if unset.
+	setenv("XDG_DATA_DIRS", "share:", 1);
+	error_count += expect("default", site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true), { "/usr/local/share" AppDirsCPP_cat, "/usr/share" AppDirsCPP_cat });
+	setenv("XDG_DATA_DIRS", "", 1);
+	error_count += expect("empty", site_data_dir(&AppDirsCPP_cstr), { "/usr/local/share" AppDirsCPP_cat });
+
+	// A long list, every entry twice.
+	_CXTSTR long_list;
+	std::vector<_CXTSTR> long_expected;
+	for (int i = 0; i < 200; i++) {
+		long_list += "/opt/app" + std::to_string(i % 100) + (i < 100 ? "/share:" : "/share/:");
+		if (i < 100) {
+			long_expected.push_back("/opt/app" + std::to_string(i) + "/share" AppDirsCPP_cat);
+		}
+	}
+	setenv("XDG_DATA_DIRS", long_list.c_str(), 1);
+	error_count += expect("long list", site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true), long_expected);
+
+	// The joined string form and PathList agree with the vector form.
+	setenv("XDG_DATA_DIRS", "/usr/share/:/usr/share", 1);
+	_CXTSTR joined;
+	site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true, joined);
+	PathList paths;
+	site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true, paths);
+	error_count += expect("joined", { joined }, { "/usr/share" AppDirsCPP_cat });
+	error_count += expect("path list", paths.to_vector(), { "/usr/share" AppDirsCPP_cat });
+
+	// Canonical mode drops a symlink to a directory already in the list.
+	char root_template[] = "/tmp/AppDirsCPP_xdg_XXXXXX";
+	const _CXTSTR root = mkdtemp(root_template);
+	mkdir((root + "/real").c_str(), 0700);
+	symlink((root + "/real").c_str(), (root + "/link").c_str());
+	setenv("XDG_DATA_DIRS", (root + "/link:" + root + "/real:" + root + "/missing").c_str(), 1);
+	error_count += expect("symlink kept", site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true), { root + "/link" AppDirsCPP_cat, root + "/real" AppDirsCPP_cat, root + "/missing" AppDirsCPP_cat });
+	char resolved[PATH_MAX];
+	const _CXTSTR real = realpath((root + "/real").c_str(), resolved);
+	appdirs_set_canonical_site_dirs(true);
+	error_count += expect("canonical", site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true), { real + AppDirsCPP_cat, root + "/missing" AppDirsCPP_cat });
+
+	// Real paths are cached until appdirs_refresh.
+	unlink((root + "/link").c_str());
+	error_count += expect("cached", site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true), { real + AppDirsCPP_cat, root + "/missing" AppDirsCPP_cat });
+	appdirs_refresh();
+	error_count += expect("refreshed", site_data_dir(&AppDirsCPP_cstr, nullptr, nullptr, true), { root + "/link" AppDirsCPP_cat, root + "/real" AppDirsCPP_cat, root + "/missing" AppDirsCPP_cat });
+	appdirs_set_canonical_site_dirs(false);
+
+	rmdir((root + "/real").c_str());
+	rmdir(root.c_str());
+#endif
+	return error_count;
+}
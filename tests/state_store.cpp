@@ -0,0 +1,106 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+#if defined(__linux__)
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static std::string value_of(const StateStore& store, const std::string& key)
+{
+	std::string value;
+	return store.get(key, value) ? value : "<none>";
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if !defined(__linux__)
+	cout << "SKIP! StateStore is only available on Linux.\n";
+#else
+	char root_template[] = "/tmp/AppDirsCPP_state_XXXXXX";
+	const _CXTSTR root = mkdtemp(root_template);
+	setenv("XDG_STATE_HOME", root.c_str(), 1);
+
+	StateStore store;
+	int error = store.open(&AppDirsCPP_cstr, nullptr, nullptr, "window", 0);
+	error_count += expect("open", !error && store.directory() == user_state_dir(&AppDirsCPP_cstr) && store.size() == 0);
+	store.set("x", "10");
+	store.set("y", "20");
+	store.set("cursor", "0");
+	store.erase("cursor");
+	error_count += expect("read own writes", value_of(store, "x") == "10" && value_of(store, "cursor") == "<none>");
+	error_count += expect("commit", !store.commit());
+	store.close();
+
+	// Journal is replayed.
+	error = store.open(&AppDirsCPP_cstr, nullptr, nullptr, "window", 0);
+	error_count += expect("reopen journal", !error && store.size() == 2 && value_of(store, "y") == "20");
+
+	// Compaction moves everything to the data file.
+	store.set("y", "21");
+	error_count += expect("compact", !store.compact());
+	const std::string directory = store.directory();
+	struct stat st;
+	error_count += expect("journal emptied", stat((directory + "/window.journal").c_str(), &st) == 0 && st.st_size == 0);
+	store.set("z", std::string(1000, 'z'));
+	store.commit();
+	store.close();
+
+	// A torn record at the end of the journal is dropped.
+	const int fd = open((directory + "/window.journal").c_str(), O_WRONLY | O_APPEND);
+	if (write(fd, "\x05\x00\x00\x00\x40\x00\x00\x00garbage", 15) < 0) {
+		cout << "ERROR: write journal;\n";
+	}
+	close(fd);
+	error = store.open(&AppDirsCPP_cstr, nullptr, nullptr, "window", 0);
+	error_count += expect("reopen data and journal", !error && store.size() == 3 && value_of(store, "y") == "21" && value_of(store, "z").size() == 1000);
+	store.set("after", "crash");
+	store.commit();
+	store.close();
+	error = store.open(&AppDirsCPP_cstr, nullptr, nullptr, "window", 0);
+	error_count += expect("torn record dropped", !error && store.size() == 4 && value_of(store, "after") == "crash");
+	store.close();
+
+	// Background compaction once the journal is large enough.
+	error = store.open(&AppDirsCPP_cstr, nullptr, nullptr, "window", 256);
+	for (int n = 0; n < 100; n++) {
+		store.set("counter", std::to_string(n));
+		store.commit();
+	}
+	store.close();
+	error = store.open(&AppDirsCPP_cstr, nullptr, nullptr, "window", 256);
+	error_count += expect("background compaction", !error && value_of(store, "counter") == "99" && stat((directory + "/window.journal").c_str(), &st) == 0 && st.st_size < 2000);
+	store.close();
+
+	// A compaction interrupted after moving the journal aside leaves both journals; neither is lost.
+	store.open(&AppDirsCPP_cstr, nullptr, nullptr, "layout", 0);
+	store.set("a", "0");
+	store.set("x", "0");
+	store.compact();
+	store.set("a", "1");
+	store.erase("x");
+	store.close();
+	rename((directory + "/layout.journal").c_str(), (directory + "/layout.journal.old").c_str());
+	store.open(&AppDirsCPP_cstr, nullptr, nullptr, "other", 0);
+	store.set("b", "2");
+	store.close();
+	rename((directory + "/other.journal").c_str(), (directory + "/layout.journal").c_str());
+	error = store.open(&AppDirsCPP_cstr, nullptr, nullptr, "layout", 0);
+	const bool old_removed = stat((directory + "/layout.journal.old").c_str(), &st) != 0;
+	error_count += expect("interrupted compaction", !error && old_removed && store.size() == 2 && value_of(store, "a") == "1" && value_of(store, "b") == "2");
+	store.close();
+	error = store.open(&AppDirsCPP_cstr, nullptr, nullptr, "layout", 0);
+	error_count += expect("interrupted compaction durable", !error && store.size() == 2 && value_of(store, "a") == "1" && value_of(store, "x") == "<none>" && value_of(store, "b") == "2");
+#endif
+	return error_count;
+}
@@ -0,0 +1,57 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+	appdirs_stats_reset();
+	user_data_dir(&AppDirsCPP_cstr);
+	user_data_dir(&AppDirsCPP_cstr);
+	site_config_dir(&AppDirsCPP_cstr);
+	resolve_all(&AppDirsCPP_cstr);
+	const AppDirsStats stats = appdirs_stats_snapshot();
+
+	if (!stats.enabled) {
+		// Compiled out: nothing is collected.
+		bool all_zero = true;
+		for (const uint64_t counter : stats.counters) {
+			all_zero = all_zero && !counter;
+		}
+		error_count += expect("disabled stats are zero", all_zero);
+		return error_count;
+	}
+
+	error_count += expect("user_data_dir calls", stats.counters[AppDirsStats::user_data_dir_calls] == 2);
+	error_count += expect("site_config_dir calls", stats.counters[AppDirsStats::site_config_dir_calls] == 1);
+	error_count += expect("resolve_all calls", stats.counters[AppDirsStats::resolve_all_calls] == 1);
+	error_count += expect("bytes built", stats.counters[AppDirsStats::bytes_built] > 0);
+	error_count += expect("allocations", stats.counters[AppDirsStats::allocations] > 0);
+#if !defined(_WIN32)
+	error_count += expect("getenv calls", stats.counters[AppDirsStats::getenv_calls] > 0);
+#endif
+#if !defined(_WIN32) && !defined(__APPLE__)
+	// Without XDG_DATA_HOME and HOME, the password database is used once, then memoized.
+	unsetenv("XDG_DATA_HOME");
+	unsetenv("HOME");
+	appdirs_stats_reset();
+	user_data_dir(&AppDirsCPP_cstr);
+	user_data_dir(&AppDirsCPP_cstr);
+	setenv("XDG_DATA_HOME", "/tmp/data", 1);
+	user_data_dir(&AppDirsCPP_cstr);
+	const AppDirsStats fallback = appdirs_stats_snapshot();
+	uint64_t timed = 0;
+	for (const uint64_t bucket : fallback.histograms[AppDirsStats::nss_lookup_ns]) {
+		timed += bucket;
+	}
+	error_count += expect("home from passwd", fallback.counters[AppDirsStats::home_passwd] == 2 && fallback.counters[AppDirsStats::nss_lookups] == 1 && timed == 1);
+	error_count += expect("xdg override", fallback.counters[AppDirsStats::xdg_override] == 1);
+#endif
+	return error_count;
+}
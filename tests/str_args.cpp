@@ -0,0 +1,80 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "internal.hpp"
+
+// Count every heap allocation made through operator new.
+static size_t allocation_count = 0;
+
+void* operator new(size_t size)
+{
+	allocation_count++;
+	void* ptr = std::malloc(size ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+static _CXTSTR join_paths(const std::vector<_CXTSTR>& full_paths)
+{
+	_CXTSTR joined;
+	for (const auto& full_path : full_paths) {
+		if (!joined.empty()) {
+			joined += pathsep;
+		}
+		joined += full_path;
+	}
+	return joined;
+}
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+
+	// Literals give the same results as string pointers.
+	error_count += expect("user_data_dir", user_data_dir(AppDirsCPP_str, AppAuthor_str, version_str) == user_data_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr));
+	error_count += expect("site_data_dir", join_paths(site_data_dir(AppDirsCPP_str, nullptr, version_str, true)) == join_paths(site_data_dir(&AppDirsCPP_cstr, nullptr, &version_cstr, true)));
+	error_count += expect("user_config_dir", user_config_dir(AppDirsCPP_str) == user_config_dir(&AppDirsCPP_cstr));
+	error_count += expect("site_config_dir", join_paths(site_config_dir(AppDirsCPP_str, AppAuthor_str)) == join_paths(site_config_dir(&AppDirsCPP_cstr, &AppAuthor_cstr)));
+	error_count += expect("user_cache_dir", user_cache_dir(AppDirsCPP_str, AppAuthor_str, nullptr, true) == user_cache_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, nullptr, true));
+	error_count += expect("user_state_dir", user_state_dir(AppDirsCPP_str, nullptr, version_str) == user_state_dir(&AppDirsCPP_cstr, nullptr, &version_cstr));
+	error_count += expect("user_log_dir", user_log_dir(AppDirsCPP_str) == user_log_dir(&AppDirsCPP_cstr));
+
+	// Mixing a string pointer with a literal.
+	error_count += expect("mixed arguments", user_data_dir(&AppDirsCPP_cstr, AppAuthor_str) == user_data_dir(&AppDirsCPP_cstr, &AppAuthor_cstr));
+
+	// Length-delimited argument, e.g. a piece of a larger string.
+	const _CXTCHAR name_and_more[] = AppDirsCPP_str _CXT("-extra");
+	error_count += expect("length argument", user_data_dir(AppDirsStr(name_and_more, AppDirsCPP_cstr.length())) == user_data_dir(&AppDirsCPP_cstr));
+
+	const AppDirs dirs = resolve_all(AppDirsCPP_str, AppAuthor_str, version_str);
+	error_count += expect("resolve_all", dirs.str(AppDirs::user_cache) == user_cache_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr));
+
+#if !defined(_WIN32)
+	// Literals into a buffer build no string at all.
+	_CXTCHAR buffer[4096];
+	const size_t before = allocation_count;
+	const size_t length = user_cache_dir(AppDirsCPP_str, AppAuthor_str, version_str, true, buffer, 4096);
+	const size_t allocations = allocation_count - before;
+	error_count += expect("no allocation", length && allocations == 0);
+#endif
+	return error_count;
+}
@@ -0,0 +1,64 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <array>
+#include <iostream>
+#include <thread>
+
+#include "internal.hpp"
+
+#if !defined(_WIN32)
+#include <pwd.h>
+#include <unistd.h>
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if defined(_WIN32)
+	cout << "SKIP! home directory is provided by Windows shell API.\n";
+#else
+	const passwd* pw = getpwuid(getuid());
+	if (!pw || !pw->pw_dir) {
+		cout << "SKIP! no password database entry for current user.\n";
+		return 0;
+	}
+	const _CXTSTR home = pw->pw_dir;
+	unsetenv("HOME");
+	unsetenv("XDG_CACHE_HOME");
+
+	// Concurrent lookups must all see the password database's home directory.
+	std::array<_CXTSTR, 16> results;
+	std::array<std::thread, 16> threads;
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i] = std::thread([&results, i]() {
+			for (int n = 0; n < 100; n++) {
+				results[i] = user_cache_dir(&AppDirsCPP_cstr);
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+#if defined(__APPLE__)
+	const _CXTSTR expected = home + "/Library/Caches" AppDirsCPP_cat;
+#else
+	const _CXTSTR expected = home + "/.cache" AppDirsCPP_cat;
+#endif
+	for (size_t i = 0; i < results.size(); i++) {
+		if (results[i] == expected) {
+			cout << "PASS! ";
+		}
+		else {
+			cout << "FAIL! ";
+			error_count++;
+		}
+		cout << "thread[" << i << "]; full_path = " << results[i] << ";\n";
+	}
+#endif
+	return error_count;
+}
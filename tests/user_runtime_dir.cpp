@@ -0,0 +1,94 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// SPDX-FileCopyrightText: 2022 AppDirsCPP contributors
+// SPDX-License-Identifier: MIT
+
+#include <AppDirsCPP.hpp>
+#include <iostream>
+
+#include "internal.hpp"
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+#include <unistd.h>
+#include <sys/stat.h>
+
+static int expect(const char* name, const _CXTSTR& full_path, const bool pass)
+{
+	cout << (pass ? "PASS! " : "FAIL! ") << name << "; full_path = " << full_path << ";\n";
+	return pass ? 0 : 1;
+}
+
+static bool is_private(const _CXTSTR& path)
+{
+	struct stat st;
+	return !lstat(path.c_str(), &st) && S_ISDIR(st.st_mode) && st.st_uid == getuid() && (st.st_mode & 0777) == 0700;
+}
+#endif
+
+int main(int argc, char const* argv[])
+{
+	int error_count = 0;
+#if defined(_WIN32) || defined(__APPLE__)
+	cout << "SKIP! XDG_RUNTIME_DIR is only used on *nix.\n";
+#else
+	char root_template[] = "/tmp/AppDirsCPP_runtime_XXXXXX";
+	const _CXTSTR root = mkdtemp(root_template);
+	const _CXTSTR fallback_shm = "/dev/shm/runtime-" + std::to_string(getuid());
+	const _CXTSTR fallback_tmp = "/tmp/runtime-" + std::to_string(getuid());
+
+	// A private $XDG_RUNTIME_DIR is used.
+	setenv("XDG_RUNTIME_DIR", root.c_str(), 1);
+	int error = -1;
+	_CXTSTR full_path = user_runtime_dir(&AppDirsCPP_cstr, &AppAuthor_cstr, &version_cstr, &error);
+	error_count += expect("XDG_RUNTIME_DIR", full_path, !error && full_path == root + AppDirsCPP_cat version_cat);
+
+	// Every form gives the same path.
+	_CXTSTR appended = "prefix:";
+	_CXTCHAR buffer[4096];
+	const size_t appended_length = user_runtime_dir(&AppDirsCPP_cstr, nullptr, nullptr, appended);
+	const size_t buffer_length = user_runtime_dir(&AppDirsCPP_cstr, nullptr, nullptr, buffer, 4096);
+	full_path = user_runtime_dir(&AppDirsCPP_cstr);
+	error_count += expect("string", appended, appended == "prefix:" + full_path && appended_length == full_path.length());
+	error_count += expect("buffer", buffer, full_path == buffer && buffer_length == full_path.length());
+	error_count += expect("literal", user_runtime_dir(AppDirsCPP_str), user_runtime_dir(AppDirsCPP_str) == full_path);
+
+	// ensure_user_runtime_dir creates the application directory.
+	full_path = ensure_user_runtime_dir(&AppDirsCPP_cstr, nullptr, nullptr, &error);
+	error_count += expect("ensure_user_runtime_dir", full_path, !error && is_private(full_path));
+	rmdir(full_path.c_str());
+
+	// Readable by others, relative, or unset, falls back to a per-uid directory, not created by the resolver.
+	struct stat st;
+	const bool shm_existed = !lstat(fallback_shm.c_str(), &st);
+	const bool tmp_existed = !lstat(fallback_tmp.c_str(), &st);
+	chmod(root.c_str(), 0755);
+	full_path = user_runtime_dir(&AppDirsCPP_cstr, nullptr, nullptr, &error);
+	const bool fallback = full_path == fallback_shm + AppDirsCPP_cat || full_path == fallback_tmp + AppDirsCPP_cat;
+	const bool created = (!shm_existed && !lstat(fallback_shm.c_str(), &st)) || (!tmp_existed && !lstat(fallback_tmp.c_str(), &st));
+	error_count += expect("not private", full_path, !error && fallback && !created);
+	setenv("XDG_RUNTIME_DIR", "relative/run", 1);
+	error_count += expect("relative", user_runtime_dir(&AppDirsCPP_cstr), user_runtime_dir(&AppDirsCPP_cstr) == full_path);
+	unsetenv("XDG_RUNTIME_DIR");
+	error_count += expect("unset", user_runtime_dir(&AppDirsCPP_cstr), user_runtime_dir(&AppDirsCPP_cstr) == full_path);
+
+	// ensure_user_runtime_dir creates the per-uid directory private, then removes what it created.
+	const _CXTSTR fallback_dir = full_path.substr(0, full_path.rfind('/'));
+	const bool fallback_existed = fallback_dir == fallback_shm ? shm_existed : tmp_existed;
+	full_path = ensure_user_runtime_dir(&AppDirsCPP_cstr, nullptr, nullptr, &error);
+	error_count += expect("ensure fallback", full_path, !error && is_private(fallback_dir) && is_private(full_path));
+	rmdir(full_path.c_str());
+	if (!fallback_existed) {
+		rmdir(fallback_dir.c_str());
+	}
+
+	// An explicit environment has no known owner, so its directory is not checked.
+	std::map<std::string, std::string> variables;
+	variables["XDG_RUNTIME_DIR"] = root;
+	const AppDirsEnv environment(variables);
+	full_path = user_runtime_dir(environment, &AppDirsCPP_cstr);
+	error_count += expect("explicit environment", full_path, full_path == root + AppDirsCPP_cat);
+
+	rmdir(root.c_str());
+#endif
+	return error_count;
+}